@@ -2,6 +2,7 @@
 #define AVL_NODE
 #include <exception>
 #include <string>
+#include <utility>
 
 typedef enum {
     LEAF,
@@ -12,7 +13,7 @@ typedef enum {
 
 template <typename Data>
 class AVLNode {
-    Data* data;
+    Data data; //stored inline, so the node is a single allocation
     AVLNode* parentNode;
     AVLNode* rightChild;
     AVLNode* leftChild;
@@ -20,40 +21,41 @@ class AVLNode {
     NodeType type;
     int height;
     int bf;
+    int size; //number of nodes in the subtree rooted here
 
     void updateType();
 public:
-    AVLNode(Data* data);
-    ~AVLNode();
+    //constructs data in place from the given arguments
+    template <typename... Args>
+    explicit AVLNode(Args&&... args);
 
     Data* getData();
-    void setData(Data*);
 
     void setRChild(AVLNode*);
     void setLChild(AVLNode*);
     void setParent(AVLNode*);
+    //links both children at once and refreshes the stats once, for bottom up construction
+    void setChildren(AVLNode* left, AVLNode* right);
 
     AVLNode* getLChild();
     AVLNode* getRChild();
     AVLNode* getParent();
+    //in-order neighbours, found through the child and parent links; NULL at either end
+    AVLNode* getNext();
+    AVLNode* getPrev();
 
     //returns true if the child to be killed is the left one
     const bool removeChild(AVLNode*);
+    //forgets all links, so a node unlinked from its tree can be linked again as a leaf
+    void resetLinks();
 
+    //cached values, refreshed by calculateStats()
     int getBF();
     int getHeight();
+    int getSize();
     NodeType getType();
     void calculateStats();
-
-    const bool operator<(AVLNode& rhs); //uses comparator
-    const bool operator<(Data* data);
-    const bool operator<(int id);
-    const bool operator>(AVLNode& rhs); //uses comparator
-    const bool operator>(Data* data);
-    const bool operator>(int id);
-    const bool operator==(AVLNode& rhs); //uses comparator
-    const bool operator==(Data* data);
-    const bool operator==(int id);
+    void calculateSize(); //refreshes only the subtree size
 
     class AVLTree_Node_Exception : public std::exception
     {
@@ -66,32 +68,18 @@ public:
 
 
 template<typename Data>
-AVLNode<Data>::AVLNode(Data* data)
+template<typename... Args>
+AVLNode<Data>::AVLNode(Args&&... args) : data(std::forward<Args>(args)...)
 {
-    if (data == NULL) throw AVLTree_Node_Exception("Data cannot be NULL");
-
-    Data* data_clone = new Data();
-    if (data_clone == NULL) throw AVLTree_Node_Exception("OUT OF MEMORY");
-    *data_clone = *data;
-    this->data = data_clone;
     this->parentNode = NULL;
     this->leftChild = NULL;
     this->rightChild = NULL;
     this->bf = 0;
-    this->height = 0;
+    this->height = 1;
+    this->size = 1;
     this->type = LEAF;
 }
 
-
-template<typename Data>
-AVLNode<Data>::~AVLNode()
-{
-	if (data != NULL) {
-		delete data;
-		data = NULL;
-	}
-}
-
 template<typename Data>
 AVLNode<Data>* AVLNode<Data>::getLChild()
 {
@@ -111,79 +99,62 @@ AVLNode<Data>* AVLNode<Data>::getParent()
 }
 
 template<typename Data>
-const bool AVLNode<Data>::removeChild(AVLNode* node)
+AVLNode<Data>* AVLNode<Data>::getNext()
 {
-	if (this->leftChild == node) {
-		this->leftChild = NULL;
-		this->calculateStats();
-		return true;
+	AVLNode* node = this->rightChild;
+	if (node != NULL) {
+		while (node->leftChild != NULL)
+			node = node->leftChild;
+		return node;
 	}
-	else if (this->rightChild == node) {
-		this->rightChild = NULL;
-		this->calculateStats();
-	}
-
-	return false;
-}
-
-template<typename Data>
-const bool AVLNode<Data>::operator<(AVLNode& rhs)
-{
-	return *(this->data) < *(rhs->getData());
-}
-
-template<typename Data>
-const bool AVLNode<Data>::operator<(Data* data)
-{
-	if (data == NULL) throw AVLTree_Node_Exception("Data cannot be NULL!");
-
-	return *(this->data) < *data;
-}
-
-template<typename Data>
-const bool AVLNode<Data>::operator<(int id)
-{
-	return *(this->data) < id;
-}
-
-template<typename Data>
-const bool AVLNode<Data>::operator>(AVLNode& rhs)
-{
-	return *(this->data) > *(rhs->getData());
-}
-
-template<typename Data>
-const bool AVLNode<Data>::operator>(Data* data)
-{
-	if (data == NULL) throw AVLTree_Node_Exception("Data cannot be NULL!");
 
-	return *(this->data) > *data;
+	//climb until we come up from a left subtree
+	node = this;
+	while (node->parentNode != NULL && node->parentNode->rightChild == node)
+		node = node->parentNode;
+	return node->parentNode;
 }
 
 template<typename Data>
-const bool AVLNode<Data>::operator>(int id)
+AVLNode<Data>* AVLNode<Data>::getPrev()
 {
-	return *(this->data) > id;
-}
+	AVLNode* node = this->leftChild;
+	if (node != NULL) {
+		while (node->rightChild != NULL)
+			node = node->rightChild;
+		return node;
+	}
 
-template<typename Data>
-const bool AVLNode<Data>::operator==(AVLNode& rhs)
-{
-	return *data == *(rhs->getData());
+	//climb until we come up from a right subtree
+	node = this;
+	while (node->parentNode != NULL && node->parentNode->leftChild == node)
+		node = node->parentNode;
+	return node->parentNode;
 }
 
 template<typename Data>
-const bool AVLNode<Data>::operator==(Data* data)
+const bool AVLNode<Data>::removeChild(AVLNode* node)
 {
-	if (data == NULL) throw AVLTree_Node_Exception("Data cannot be NULL!");
+	if (this->leftChild == node) {
+		this->leftChild = NULL;
+		this->calculateStats();
+		return true;
+	}
+	else if (this->rightChild == node) {
+		this->rightChild = NULL;
+		this->calculateStats();
+	}
 
-	return *(this->data) == *data;
+	return false;
 }
 
 template<typename Data>
-const bool AVLNode<Data>::operator==(int id)
+void AVLNode<Data>::resetLinks()
 {
-	return *(this->data) == id;
+	this->parentNode = NULL;
+	this->leftChild = NULL;
+	this->rightChild = NULL;
+	this->calculateStats();
 }
 
 template<class Data>
@@ -210,22 +181,38 @@ void AVLNode<Data>::calculateStats()
 		this->bf = -1 * this->rightChild->height;
 		break;
 	}
+
+	calculateSize();
+}
+
+template<class Data>
+void AVLNode<Data>::calculateSize()
+{
+	this->size = 1;
+	if (this->leftChild != NULL)
+		this->size += this->leftChild->size;
+	if (this->rightChild != NULL)
+		this->size += this->rightChild->size;
 }
 
 template<typename Data>
 int AVLNode<Data>::getBF()
 {
-	calculateStats();
 	return this->bf;
 }
 
 template<typename Data>
 int AVLNode<Data>::getHeight()
 {
-	calculateStats();
 	return this->height;
 }
 
+template<typename Data>
+int AVLNode<Data>::getSize()
+{
+	return this->size;
+}
+
 template<typename Data>
 NodeType AVLNode<Data>::getType()
 {
@@ -256,14 +243,7 @@ void AVLNode<Data>::updateType()
 template<typename Data>
 Data* AVLNode<Data>::getData()
 {
-	return this->data;
-}
-
-template<typename Data>
-void AVLNode<Data>::setData(Data* d)
-{
-	if (d == NULL) throw AVLTree_Node_Exception("Data cannot be null.");
-	this->data = d;
+	return &this->data;
 }
 
 
@@ -295,6 +275,19 @@ void AVLNode<Data>::setLChild(AVLNode<Data>* node)
 
 }
 
+template<typename Data>
+void AVLNode<Data>::setChildren(AVLNode<Data>* left, AVLNode<Data>* right)
+{
+	this->leftChild = left;
+	this->rightChild = right;
+	if (left != NULL)
+		left->setParent(this);
+	if (right != NULL)
+		right->setParent(this);
+
+	calculateStats();
+}
+
 template<typename Data>
 void AVLNode<Data>::setParent(AVLNode* node)
 {
@@ -1,7 +1,11 @@
 #ifndef AVL_TREE
 #define AVL_TREE
 #include "AVLNode.h"
+#include "NodePool.h"
+#include <cassert>
 #include <iostream>
+#include <iterator>
+#include <type_traits>
 
 using namespace std;
 
@@ -17,52 +21,198 @@ enum class TreeResult {
 };
 
 /// <summary>
-/// AVLTree generic class, that works with Data and uses Comparator for insertion/deletion.
+/// Default key policy, the data is its own key.
 /// </summary>
-/// <typeparam name="Data">Data class type that wraps the generic data
-/// Data is required to support < > == on:
-///                                        Data other*
-///                                        int id
-/// </typeparam>
 template <typename Data>
+struct IdentityKey
+{
+    typedef Data Key;
+    static const Data& key(const Data& data) { return data; }
+};
+
+/// <summary>
+/// Default comparator. Arithmetic keys are compared once, without branches; any other key type
+/// through operator<.
+/// </summary>
+struct ThreeWayCompare
+{
+    //negative if a < b, zero if equal, positive if a > b
+    template <typename A, typename B>
+    static constexpr int compare(const A& a, const B& b) {
+        return compare(a, b, std::integral_constant<bool, std::is_arithmetic<A>::value && std::is_arithmetic<B>::value>());
+    }
+
+private:
+    template <typename A, typename B>
+    static constexpr int compare(const A& a, const B& b, std::true_type) { return (a > b) - (a < b); }
+    template <typename A, typename B>
+    static constexpr int compare(const A& a, const B& b, std::false_type) { return a < b ? -1 : (b < a ? 1 : 0); }
+};
+
+/// <summary>
+/// AVLTree generic class, that works with Data and orders it by the key KeyOf extracts.
+/// </summary>
+/// <typeparam name="Data">Data class type that wraps the generic data</typeparam>
+/// <typeparam name="KeyOf">provides typedef Key and static Key key(const Data&)</typeparam>
+/// <typeparam name="Compare">provides static int compare(const Key&, const K&) for every key
+/// type K used in a lookup, negative/zero/positive like strcmp</typeparam>
+/// <typeparam name="Allocator">provides the node memory, see NodePool for the interface</typeparam>
+template <typename Data, typename KeyOf = IdentityKey<Data>, typename Compare = ThreeWayCompare,
+    typename Allocator = NodePool<AVLNode<Data> > >
 class AVLTree
 {
+public:
+    typedef typename KeyOf::Key Key;
+
+private:
     AVLNode<Data>* root;
     int nodes_count;
+    Allocator allocator;
 
 	AVLNode<Data>* highest;
+	AVLNode<Data>* lowest;
 
+    //compares node's key with key, negative if node's is smaller
+    template <typename K>
+    static int compareTo(AVLNode<Data>* node, const K& key) {
+        return Compare::compare(KeyOf::key(*node->getData()), key);
+    }
     //if found, return node, else, return father node
-    AVLNode<Data>* findNode(Data* data, bool& found);
-    AVLNode<Data>* findNode(const int id, bool& found);
+    template <typename K>
+    AVLNode<Data>* findNode(const K& key, bool& found);
 
     AVLNode<Data>* llRotation(AVLNode<Data>* node);
     AVLNode<Data>* rrRotation(AVLNode<Data>* node);
     AVLNode<Data>* rlRotation(AVLNode<Data>* node);
     AVLNode<Data>* lrRotation(AVLNode<Data>* node);
-    TreeResult balanceTree(AVLNode<Data>* node); //check parent
+    AVLNode<Data>* rotate(AVLNode<Data>* node); //returns the new subtree root
+    //walks up from node, whose height was oldHeight before the update, until heights stop changing,
+    //then refreshes the subtree sizes up to the root
+    TreeResult balanceTree(AVLNode<Data>* node, int oldHeight, bool insertion);
+    void replaceChild(AVLNode<Data>* parent, AVLNode<Data>* oldChild, AVLNode<Data>* newChild);
+    TreeResult linkNode(AVLNode<Data>* newNode, AVLNode<Data>** inserted);
+    //hangs a fresh leaf under parent (NULL for an empty tree) and rebalances
+    void attachLeaf(AVLNode<Data>* parent, AVLNode<Data>* leaf);
+    //takes node out of the tree and rebalances, without destroying it
+    void unlinkNode(AVLNode<Data>* node);
+    void deleteNodes(AVLNode<Data>* node);
+    //builds a perfectly balanced subtree from the next count data of first, bottom up
+    template <typename It, typename Visit>
+    AVLNode<Data>* buildNodes(It& first, int count, Visit& visit);
+
+    //join/split work on detached subtrees (root's parent is NULL) and return the new subtree root
+    AVLNode<Data>* rebalanceUp(AVLNode<Data>* node);
+    //every key in left < pivot < every key in right; pivot must have no links
+    AVLNode<Data>* joinNodes(AVLNode<Data>* left, AVLNode<Data>* pivot, AVLNode<Data>* right);
+    //splits node's subtree around key, returns the detached node equal to key or NULL
+    AVLNode<Data>* splitNodes(AVLNode<Data>* node, const Key& key, AVLNode<Data>** less, AVLNode<Data>** greater);
+    //splits other by driver's keys, so the cost is O(m log(n/m + 1)) with m the driver's size.
+    //on equal keys the node from this tree is kept and the other one destroyed.
+    AVLNode<Data>* unionNodes(AVLNode<Data>* driver, AVLNode<Data>* other, bool driverIsThis, int& duplicates);
+    //k-th smallest node (1-based) by descending on the subtree sizes, NULL if k is out of range
+    AVLNode<Data>* selectNode(int k);
 
 public:
     AVLTree();
-	AVLTree(AVLNode<Data>* r, int size);
     ~AVLTree();
+    AVLTree(const AVLTree&) = delete;
+    AVLTree& operator=(const AVLTree&) = delete;
+
+	//nodes must be created by this tree's createNode and released by destroyNode
+	template <typename... Args>
+	AVLNode<Data>* createNode(Args&&... args);
+	void destroyNode(AVLNode<Data>* node);
+	//replaces the contents with [first, last), which must be sorted by key with no duplicates.
+	//O(n): no search or rotation, and the nodes come from one contiguous run of the allocator.
+	//visit(node) is called on every new node in key order. On failure the tree is unchanged.
+	template <typename It>
+	TreeResult buildFromSorted(It first, It last);
+	template <typename It, typename Visit>
+	TreeResult buildFromSorted(It first, It last, Visit visit);
 	
-	//if not found, return NULL
-    Data* findData(const int identifier);
-
-	const TreeResult insertNode(Data* data, AVLNode<Data>** inserted);
-    const TreeResult deleteNode(int id);
-	const TreeResult deleteByPointer(AVLNode<Data>* node, AVLNode<Data>** swapped);
+	//if not found, return NULL. key may be of any type Compare accepts against Key
+	template <typename K>
+    Data* findData(const K& key);
+
+	//data is copied/moved into the new node; on NODE_ALREADY_EXISTS inserted points to the existing node
+	TreeResult insertNode(const Data& data, AVLNode<Data>** inserted);
+	TreeResult insertNode(Data&& data, AVLNode<Data>** inserted);
+	//constructs the data in place from args
+	template <typename... Args>
+	TreeResult emplaceNode(AVLNode<Data>** inserted, Args&&... args);
+	template <typename K>
+    TreeResult deleteNode(const K& key);
+	//nodes are relinked rather than swapped, so pointers to other nodes' data stay valid
+	TreeResult deleteByPointer(AVLNode<Data>* node);
+	//call after node's key has changed. Moves node to its new place without reallocating it,
+	//and does nothing if the key still falls between its in-order neighbours.
+	//the new key must not be equal to another node's.
+	TreeResult reposition(AVLNode<Data>* node);
+	//moves every node of other into this tree and leaves other empty. Nodes are relinked, not
+	//copied, so pointers to their data stay valid. On equal keys this tree's data is kept.
+	void merge(AVLTree& other);
     const int getSize();
-	void updateHighest();
     Data* getHighest() { 
 		if (!highest) return NULL;
 		return highest->getData();
 	}
+    Data* getLowest() {
+		if (!lowest) return NULL;
+		return lowest->getData();
+	}
     AVLNode<Data>* getRoot() { return root; }
 
-	int inorder(AVLNode<Data>* p, Data** arr, int numOfNodes, int i = 0);
-	Data** orderedArray(int size);
+	//number of nodes whose key is not greater than key, which is key's 1-based rank if it is in the tree
+	template <typename K>
+	int rank(const K& key);
+	//k-th smallest data (1-based), if k is out of range return NULL
+	Data* select(int k);
+
+	/// <summary>
+	/// In-order cursor over the tree's data. Steps through the parent links, O(1) amortized and
+	/// with no allocation. Any insert or delete other than of the current node invalidates it.
+	/// </summary>
+	/// <typeparam name="Reverse">true to walk from the highest data down</typeparam>
+	template <bool Reverse>
+	class Cursor
+	{
+		AVLNode<Data>* node;
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef Data value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef Data* pointer;
+		typedef Data& reference;
+
+		explicit Cursor(AVLNode<Data>* node = NULL) : node(node) {}
+
+		Data& operator*() const { return *node->getData(); }
+		Data* operator->() const { return node->getData(); }
+		AVLNode<Data>* getNode() const { return node; }
+
+		Cursor& operator++() {
+			node = Reverse ? node->getPrev() : node->getNext();
+			return *this;
+		}
+		Cursor operator++(int) {
+			Cursor old = *this;
+			++(*this);
+			return old;
+		}
+
+		bool operator==(const Cursor& other) const { return node == other.node; }
+		bool operator!=(const Cursor& other) const { return node != other.node; }
+	};
+	typedef Cursor<false> Iterator;
+	typedef Cursor<true> ReverseIterator;
+
+	Iterator begin() { return Iterator(lowest); }
+	Iterator end() { return Iterator(); }
+	ReverseIterator rbegin() { return ReverseIterator(highest); }
+	ReverseIterator rend() { return ReverseIterator(); }
+	//cursors at the k-th data (1-based) in their own order, O(log n); end()/rend() if k is out of range
+	Iterator iteratorAt(int k) { return Iterator(selectNode(k)); }
+	ReverseIterator reverseIteratorAt(int k) { return ReverseIterator(selectNode(nodes_count + 1 - k)); }
 
 	//int treeHeight() { return root->getHeight(); }
     
@@ -79,75 +229,26 @@ public:
 };
 
 
-template<typename Data>
-AVLNode<Data>* AVLTree<Data>::findNode(Data* data, bool& found)
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+template<typename K>
+AVLNode<Data>* AVLTree<Data, KeyOf, Compare, Allocator>::findNode(const K& key, bool& found)
 {
-	if (data == NULL) throw AVLTree_Exception("data argument cannot be NULL");
-
+	found = false;
 	AVLNode<Data>* node = this->root;
 	while (node != NULL)
 	{
-		if (*node->getData() == *data) {
+		int cmp = compareTo(node, key);
+		if (cmp == 0) {
 			found = true;
-			break;
+			return node;
 		}
 
-		else if (*node->getData() > *data) //search within left subtree
-		{
-			if (node->getLChild() == NULL)
-			{
-				found = false;
-				return node;
-			}
+		//search within left subtree if node is greater, else within right subtree
+		AVLNode<Data>* next = cmp > 0 ? node->getLChild() : node->getRChild();
+		if (next == NULL)
+			return node;
 
-			node = node->getLChild();
-		}
-		else //search within right subtree
-		{
-			if (node->getRChild() == NULL)
-			{
-				found = false;
-				return node;
-			}
-
-			node = node->getRChild();
-		}
-	}
-
-	return node;
-}
-
-template<typename Data>
-AVLNode<Data>* AVLTree<Data>::findNode(const int id, bool& found)
-{
-	AVLNode<Data>* node = this->root;
-	while (node != NULL)
-	{
-		if (*node == id) {
-			found = true;
-			break;
-		}
-
-		else if (*node > id) //search within left subtree
-		{
-			if (node->getLChild() == NULL)
-			{
-				found = false;
-				return node;
-			}
-
-			node = node->getLChild();
-		}
-		else //search within right subtree
-		{
-			if (node == NULL)
-			{
-				found = false;
-				return node;
-			}
-
-			node = node->getRChild();
-		}
+		node = next;
 	}
 
 	return node;
@@ -167,16 +268,17 @@ static bool is_right_child(AVLNode<Data>* parent, AVLNode<Data>* child)
 	return parent->getRChild() == child;
 }
 
-template<typename Data>
-AVLNode<Data>* AVLTree<Data>::llRotation(AVLNode<Data>* node)
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+AVLNode<Data>* AVLTree<Data, KeyOf, Compare, Allocator>::llRotation(AVLNode<Data>* node)
 {
-	if (node == NULL) throw AVLTree_Exception("node argument cannot be NULL");
+	assert(node != NULL);
 
 	AVLNode<Data>* new_node = node->getLChild();
+	auto* grandpa = node->getParent();
 	node->setLChild(new_node->getRChild());
+	new_node->setRChild(node);
 
-	//update grandpa link
-	auto* grandpa = node->getParent();
+	//update grandpa link last, so its stats see new_node's final height
 	if (is_left_child(grandpa, node))
 	{
 		grandpa->setLChild(new_node);
@@ -185,23 +287,22 @@ AVLNode<Data>* AVLTree<Data>::llRotation(AVLNode<Data>* node)
 	{
 		grandpa->setRChild(new_node);
 	}
-
-	new_node->setRChild(node);
 	if (this->root == node) //update root if needed
 		this->root = new_node;
 	return new_node;
 }
 
-template<typename Data>
-AVLNode<Data>* AVLTree<Data>::rrRotation(AVLNode<Data>* node)
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+AVLNode<Data>* AVLTree<Data, KeyOf, Compare, Allocator>::rrRotation(AVLNode<Data>* node)
 {
-	if (node == NULL) throw AVLTree_Exception("node argument cannot be NULL");
+	assert(node != NULL);
 
 	AVLNode<Data>* new_node = node->getRChild();
+	auto* grandpa = node->getParent();
 	node->setRChild(new_node->getLChild());
+	new_node->setLChild(node);
 
-	//update grandpa link
-	auto* grandpa = node->getParent();
+	//update grandpa link last, so its stats see new_node's final height
 	if (is_left_child(grandpa, node))
 	{
 		grandpa->setLChild(new_node);
@@ -210,81 +311,77 @@ AVLNode<Data>* AVLTree<Data>::rrRotation(AVLNode<Data>* node)
 	{
 		grandpa->setRChild(new_node);
 	}
-
-	new_node->setLChild(node);
 	if (this->root == node) //update root if needed
 		this->root = new_node;
 	return new_node;
 }
 
-template<typename Data>
-AVLNode<Data>* AVLTree<Data>::rlRotation(AVLNode<Data>* node)
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+AVLNode<Data>* AVLTree<Data, KeyOf, Compare, Allocator>::rlRotation(AVLNode<Data>* node)
 {
-	if (node == NULL) throw AVLTree_Exception("node argument cannot be NULL");
+	assert(node != NULL);
 
 	AVLNode<Data>* new_node = node->getRChild();
 	node->setRChild(llRotation(new_node));
 	return rrRotation(node);
 }
 
-template<typename Data>
-AVLNode<Data>* AVLTree<Data>::lrRotation(AVLNode<Data>* node)
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+AVLNode<Data>* AVLTree<Data, KeyOf, Compare, Allocator>::lrRotation(AVLNode<Data>* node)
 {
-	if (node == NULL) throw AVLTree_Exception("node argument cannot be NULL");
+	assert(node != NULL);
 
 	AVLNode<Data>* new_node = node->getLChild();
 	node->setLChild(rrRotation(new_node));
 	return llRotation(node);
 }
 
-template<typename Data>
-TreeResult AVLTree<Data>::balanceTree(AVLNode<Data>* node)
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+AVLNode<Data>* AVLTree<Data, KeyOf, Compare, Allocator>::rotate(AVLNode<Data>* node)
+{
+	if (node->getBF() > 1) {
+		if (node->getLChild()->getBF() >= 0)
+			return llRotation(node);
+		return lrRotation(node);
+	}
+
+	if (node->getRChild()->getBF() <= 0)
+		return rrRotation(node);
+	return rlRotation(node);
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+TreeResult AVLTree<Data, KeyOf, Compare, Allocator>::balanceTree(AVLNode<Data>* node, int oldHeight, bool insertion)
 {
 	if (node == NULL) return TreeResult::NULL_ARGUMENT;
 
-	int bf = node->getBF();
-	if (bf > 1) {
-		int left_bf = node->getLChild()->getBF();
-		if (left_bf > 0) {
-			node = llRotation(node);
-			if (node == root)
-				return TreeResult::SUCCESS;
-			else
-				return balanceTree(node->getParent());
-		}
-		else {
-			node = lrRotation(node);
-			if (node == root)
-				return TreeResult::SUCCESS;
-			else
-				return balanceTree(node->getParent());
-		}
-	}
-	else if (bf < -1) {
-		int right_bf = node->getRChild()->getBF();
-		if (right_bf > 0) {
-			node = rlRotation(node);
-			if (node == root)
-				return TreeResult::SUCCESS;
-			else
-				return balanceTree(node->getParent());
-		}
-		else {
-			node = rrRotation(node);
-			if (node == root)
-				return TreeResult::SUCCESS;
-			else
-				return balanceTree(node->getParent());
+	while (node != NULL)
+	{
+		//read before rotating, the rotation relinks (and so recalculates) the parent
+		AVLNode<Data>* parent = node->getParent();
+		int parentHeight = parent != NULL ? parent->getHeight() : 0;
+
+		node->calculateStats();
+
+		int bf = node->getBF();
+		if (bf > 1 || bf < -1) {
+			node = rotate(node);
+			//a rotation after an insertion always restores the subtree's previous height
+			if (insertion || node->getHeight() == oldHeight)
+				break;
 		}
-	}
-	else {
-		if (node == root)
-			return TreeResult::SUCCESS;
-		else
-			return balanceTree(node->getParent());
+		else if (node->getHeight() == oldHeight)
+			break;
 
+		node = parent;
+		oldHeight = parentHeight;
 	}
-	return TreeResult::FAILURE;
+
+	//heights have settled, but every ancestor still gained or lost a node
+	for (; node != NULL; node = node->getParent())
+		node->calculateSize();
+
+	return TreeResult::SUCCESS;
 }
 
 template<typename Data>
@@ -299,17 +396,9 @@ static AVLNode<Data>* get_replacement(AVLNode<Data>* root)
 	return node;
 }
 
+//unlinks node from its parent; the node itself is left for the caller to destroy
 template<typename Data>
-static void swap_nodes(AVLNode<Data>* n1, AVLNode<Data>* n2)
-{
-	auto* data = n1->getData();
-	n1->setData(n2->getData());
-	n2->setData(data);
-
-}
-
-template<typename Data>
-static void delete_leaf_or_onechild_node(AVLNode<Data>* node)
+static void unlink_leaf_or_onechild_node(AVLNode<Data>* node)
 {
 	auto* parent = node->getParent();
 
@@ -317,21 +406,18 @@ static void delete_leaf_or_onechild_node(AVLNode<Data>* node)
 	{
 	case LEAF:
 		parent->removeChild(node);
-		delete node;
 		break;
 
 	case HAS_LEFT_CHILD:
 		if (parent->removeChild(node) == true) //node is parent's left child
 			parent->setLChild(node->getLChild());
 		else parent->setRChild(node->getLChild());
-		delete node;
 		break;
 
 	case HAS_RIGHT_CHILD:
 		if (parent->removeChild(node) == true) //node is father's left child
 			parent->setLChild(node->getRChild());
 		else parent->setRChild(node->getRChild());
-		delete node;
 		break;
 
 	default:
@@ -339,27 +425,112 @@ static void delete_leaf_or_onechild_node(AVLNode<Data>* node)
 	}
 }
 
-template<typename Data>
-AVLTree<Data>::AVLTree()
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+AVLTree<Data, KeyOf, Compare, Allocator>::AVLTree()
 {
 	root = NULL;
 	nodes_count = 0;
 	highest = NULL;
+	lowest = NULL;
 }
 
-template<typename Data>
-inline AVLTree<Data>::AVLTree(AVLNode<Data>* r, int size)
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+template<typename... Args>
+AVLNode<Data>* AVLTree<Data, KeyOf, Compare, Allocator>::createNode(Args&&... args)
 {
-	this->root = r;
-	this->nodes_count = size;
-	this->updateHighest();
+	void* cell = allocator.allocate();
+	try {
+		return new (cell) AVLNode<Data>(std::forward<Args>(args)...);
+	}
+	catch (...) {
+		allocator.deallocate(cell);
+		throw;
+	}
 }
 
-template<typename Data>
-Data* AVLTree<Data>::findData(const int identifier)
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+void AVLTree<Data, KeyOf, Compare, Allocator>::destroyNode(AVLNode<Data>* node)
+{
+	node->~AVLNode<Data>();
+	allocator.deallocate(node);
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+template<typename It, typename Visit>
+AVLNode<Data>* AVLTree<Data, KeyOf, Compare, Allocator>::buildNodes(It& first, int count, Visit& visit)
+{
+	if (count <= 0)
+		return NULL;
+
+	//the left half gets the smaller share, so heights never differ by more than one
+	int leftCount = (count - 1) / 2;
+	AVLNode<Data>* left = buildNodes(first, leftCount, visit);
+
+	AVLNode<Data>* node = NULL;
+	AVLNode<Data>* right = NULL;
+	try {
+		node = createNode(*first);
+		++first;
+		visit(node);
+		right = buildNodes(first, count - leftCount - 1, visit);
+	}
+	catch (...) {
+		deleteNodes(left);
+		if (node != NULL)
+			destroyNode(node);
+		throw;
+	}
+
+	node->setChildren(left, right);
+	return node;
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+template<typename It>
+TreeResult AVLTree<Data, KeyOf, Compare, Allocator>::buildFromSorted(It first, It last)
+{
+	return buildFromSorted(first, last, [](AVLNode<Data>*) {});
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+template<typename It, typename Visit>
+TreeResult AVLTree<Data, KeyOf, Compare, Allocator>::buildFromSorted(It first, It last, Visit visit)
+{
+	int count = (int)std::distance(first, last);
+
+	//the first and last nodes built are the extremes, so no spine walk is needed
+	AVLNode<Data>* newLowest = NULL;
+	AVLNode<Data>* newHighest = NULL;
+	auto track = [&](AVLNode<Data>* node) {
+		if (newLowest == NULL)
+			newLowest = node;
+		newHighest = node;
+		visit(node);
+	};
+
+	AVLNode<Data>* newRoot = NULL;
+	try {
+		allocator.reserve(count);
+		newRoot = buildNodes(first, count, track);
+	}
+	catch (const bad_alloc&) {
+		return TreeResult::OUT_OF_MEMORY;
+	}
+
+	deleteNodes(this->root);
+	this->root = newRoot;
+	this->nodes_count = count;
+	this->lowest = newLowest;
+	this->highest = newHighest;
+	return TreeResult::SUCCESS;
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+template<typename K>
+Data* AVLTree<Data, KeyOf, Compare, Allocator>::findData(const K& key)
 {
 	bool found = false;
-	AVLNode<Data>* node = findNode(identifier, found);
+	AVLNode<Data>* node = findNode(key, found);
 
 	if (found)
 		return node->getData();
@@ -367,184 +538,495 @@ Data* AVLTree<Data>::findData(const int identifier)
 	return NULL;
 }
 
-template<typename Data>
-const TreeResult AVLTree<Data>::insertNode(Data* data, AVLNode<Data>** inserted)
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+void AVLTree<Data, KeyOf, Compare, Allocator>::replaceChild(AVLNode<Data>* parent, AVLNode<Data>* oldChild, AVLNode<Data>* newChild)
 {
-    try {
-        if (data == NULL) return TreeResult::NULL_ARGUMENT;
+	if (parent == NULL) {
+		this->root = newChild;
+		if (newChild != NULL)
+			newChild->setParent(NULL);
+	}
+	else if (parent->getLChild() == oldChild)
+		parent->setLChild(newChild);
+	else
+		parent->setRChild(newChild);
+}
 
-        if (root == NULL) {
-            root = new AVLNode<Data>(data);
-            this->nodes_count++;
-			this->highest = root;
-			if (inserted != nullptr) *inserted = root;
-            return TreeResult::SUCCESS;
-        }
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+TreeResult AVLTree<Data, KeyOf, Compare, Allocator>::linkNode(AVLNode<Data>* newNode, AVLNode<Data>** inserted)
+{
+	bool found = false;
+	AVLNode<Data>* node = findNode(KeyOf::key(*newNode->getData()), found);
 
-        bool found = false;
-        AVLNode<Data>* node = findNode(data, found);
+	if (found) {
+		destroyNode(newNode);
+		if (inserted != nullptr) *inserted = node;
+		return TreeResult::NODE_ALREADY_EXISTS;
+	}
 
-		if (found) {
-			if (inserted != nullptr) *inserted = node;
-            return TreeResult::NODE_ALREADY_EXISTS;
-		}
+	attachLeaf(node, newNode);
 
-        else if (*node < data) {
-            AVLNode<Data>* newNode = new AVLNode<Data>(data);
-
-            this->nodes_count++;
-            node->setRChild(newNode);
-            if (balanceTree(newNode) != TreeResult::SUCCESS)
-                throw AVLTree_Exception("error");
-
-			if (*highest < data)
-				this->highest = newNode;
-
-			if (inserted != nullptr) *inserted = newNode;
-            return TreeResult::SUCCESS;
-        }
-        else if (*node > data) {
-            AVLNode<Data>* newNode = new AVLNode<Data>(data);
-            this->nodes_count++;
-            node->setLChild(newNode);
-            if (balanceTree(newNode) != TreeResult::SUCCESS)
-                throw AVLTree_Exception("error");
-			
-			if (inserted != nullptr) *inserted = newNode;
-            return  TreeResult::SUCCESS;
-        }
-        return TreeResult::FAILURE;
-    }
-   catch(const bad_alloc&) {
-        return TreeResult::OUT_OF_MEMORY;
-    }
+	if (inserted != nullptr) *inserted = newNode;
+	return TreeResult::SUCCESS;
 }
 
-template<typename Data>
-inline const TreeResult AVLTree<Data>::deleteNode(int id)
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+void AVLTree<Data, KeyOf, Compare, Allocator>::attachLeaf(AVLNode<Data>* parent, AVLNode<Data>* leaf)
+{
+	this->nodes_count++;
+
+	if (parent == NULL) {
+		this->root = leaf;
+		this->highest = leaf;
+		this->lowest = leaf;
+		return;
+	}
+
+	const Key& key = KeyOf::key(*leaf->getData());
+	int oldHeight = parent->getHeight();
+	if (compareTo(parent, key) < 0)
+		parent->setRChild(leaf);
+	else
+		parent->setLChild(leaf);
+
+	if (balanceTree(parent, oldHeight, true) != TreeResult::SUCCESS)
+		throw AVLTree_Exception("error");
+
+	if (compareTo(highest, key) < 0)
+		this->highest = leaf;
+	if (compareTo(lowest, key) > 0)
+		this->lowest = leaf;
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+TreeResult AVLTree<Data, KeyOf, Compare, Allocator>::insertNode(const Data& data, AVLNode<Data>** inserted)
+{
+	bool found = false;
+	AVLNode<Data>* node = findNode(KeyOf::key(data), found);
+	if (found) {
+		if (inserted != nullptr) *inserted = node;
+		return TreeResult::NODE_ALREADY_EXISTS;
+	}
+
+	try {
+		return linkNode(createNode(data), inserted);
+	}
+	catch (const bad_alloc&) {
+		return TreeResult::OUT_OF_MEMORY;
+	}
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+TreeResult AVLTree<Data, KeyOf, Compare, Allocator>::insertNode(Data&& data, AVLNode<Data>** inserted)
+{
+	bool found = false;
+	AVLNode<Data>* node = findNode(KeyOf::key(data), found);
+	if (found) {
+		if (inserted != nullptr) *inserted = node;
+		return TreeResult::NODE_ALREADY_EXISTS;
+	}
+
+	try {
+		return linkNode(createNode(std::move(data)), inserted);
+	}
+	catch (const bad_alloc&) {
+		return TreeResult::OUT_OF_MEMORY;
+	}
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+template<typename... Args>
+TreeResult AVLTree<Data, KeyOf, Compare, Allocator>::emplaceNode(AVLNode<Data>** inserted, Args&&... args)
+{
+	try {
+		return linkNode(createNode(std::forward<Args>(args)...), inserted);
+	}
+	catch (const bad_alloc&) {
+		return TreeResult::OUT_OF_MEMORY;
+	}
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+template<typename K>
+inline TreeResult AVLTree<Data, KeyOf, Compare, Allocator>::deleteNode(const K& key)
 {
 	bool found = false;
-	AVLNode<Data>* node = findNode(id, found);
+	AVLNode<Data>* node = findNode(key, found);
 	if (!found)
 		return TreeResult::NODE_DOESNT_EXISTS;
 	
-	return deleteByPointer(node, nullptr);
+	return deleteByPointer(node);
 }
 
-template<typename Data>
-inline const TreeResult AVLTree<Data>::deleteByPointer(AVLNode<Data>* node, AVLNode<Data>** swapped)
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+inline TreeResult AVLTree<Data, KeyOf, Compare, Allocator>::deleteByPointer(AVLNode<Data>* node)
+{
+	unlinkNode(node);
+	destroyNode(node);
+	return TreeResult::SUCCESS;
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+TreeResult AVLTree<Data, KeyOf, Compare, Allocator>::reposition(AVLNode<Data>* node)
+{
+	const Key& key = KeyOf::key(*node->getData());
+	AVLNode<Data>* prev = node->getPrev();
+	AVLNode<Data>* next = node->getNext();
+	if ((prev == NULL || compareTo(prev, key) < 0) && (next == NULL || compareTo(next, key) > 0))
+		return TreeResult::SUCCESS;
+
+	unlinkNode(node);
+	node->resetLinks();
+
+	bool found = false;
+	AVLNode<Data>* parent = findNode(key, found);
+	if (found)
+		throw AVLTree_Exception("repositioned key already exists");
+
+	attachLeaf(parent, node);
+	return TreeResult::SUCCESS;
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+void AVLTree<Data, KeyOf, Compare, Allocator>::unlinkNode(AVLNode<Data>* node)
 {
+	//nodes keep their identity through relinks and rotations, so only removing an extreme moves it
+	if (node == this->highest)
+		this->highest = node->getPrev();
+	if (node == this->lowest)
+		this->lowest = node->getNext();
+
 	auto* parent = node->getParent();
+	//height of the lowest node whose subtree shrinks, before the unlink
+	int oldHeight = parent != NULL ? parent->getHeight() : 0;
 
 	switch (node->getType())
 	{
 	case LEAF:
-		if (swapped) *swapped = nullptr;
-
 		if (this->root == node)
-		{
 			this->root = NULL;
-			delete node;
-		}
 		else
-			delete_leaf_or_onechild_node(node);
+			unlink_leaf_or_onechild_node(node);
 		break;
 	case HAS_LEFT_CHILD:
-		if (swapped) *swapped = nullptr;
-
 		if (this->root == node)
 		{
 			this->root = node->getLChild();
 			this->root->setParent(NULL);
-			delete node;
 		}
 		else
-			delete_leaf_or_onechild_node(node);
+			unlink_leaf_or_onechild_node(node);
 		break;
 	case HAS_RIGHT_CHILD:
-		if (swapped) *swapped = nullptr;
-
 		if (this->root == node)
 		{
 			this->root = node->getRChild();
 			this->root->setParent(NULL);
-			delete node;
 		}
 		else
-			delete_leaf_or_onechild_node(node);
+			unlink_leaf_or_onechild_node(node);
 		break;
 	case HAS_CHILDREN:
+		//move the in-order successor into node's position
 		AVLNode<Data>* replacement = get_replacement(node);
-		swap_nodes(node, replacement);
-		if (swapped) *swapped = node;
-		parent = replacement->getParent();
-		delete_leaf_or_onechild_node(replacement);
+		if (replacement->getParent() != node) {
+			parent = replacement->getParent();
+			oldHeight = parent->getHeight();
+			AVLNode<Data>* orphan = replacement->getRChild();
+
+			//relink before detaching, so the nodes above parent still hold their old heights
+			replacement->setRChild(node->getRChild());
+			replacement->setLChild(node->getLChild());
+			replaceChild(node->getParent(), node, replacement);
+			parent->setLChild(orphan);
+		}
+		else {
+			//node's right child takes its place. It is rebalanced here, since relinking it
+			//already refreshed the node above, and the walk starts from there.
+			parent = node->getParent();
+			oldHeight = parent != NULL ? parent->getHeight() : 0;
+			replacement->setLChild(node->getLChild());
+			replaceChild(parent, node, replacement);
+			if (replacement->getBF() > 1 || replacement->getBF() < -1)
+				rotate(replacement);
+		}
 		break;
 	}
 
-	balanceTree(parent);
+	balanceTree(parent, oldHeight, false);
 	this->nodes_count--;
-	updateHighest();
-	return TreeResult::SUCCESS;
 }
 
 template<typename Data>
-const int AVLTree<Data>::getSize()
+static int height_of(AVLNode<Data>* node)
 {
-	return this->nodes_count;
+	return node != NULL ? node->getHeight() : 0;
 }
 
 template<typename Data>
-inline void AVLTree<Data>::updateHighest()
+static AVLNode<Data>* detach_left(AVLNode<Data>* node)
 {
-	if (this->nodes_count == 0) {
-		this->highest = NULL;
-		return;
+	AVLNode<Data>* child = node->getLChild();
+	if (child != NULL) {
+		node->setLChild(NULL);
+		child->setParent(NULL);
 	}
-	
-	AVLNode<Data>* temp = this->root;
-	while (temp->getRChild() != NULL) {
-		temp = temp->getRChild();
+	return child;
+}
+
+template<typename Data>
+static AVLNode<Data>* detach_right(AVLNode<Data>* node)
+{
+	AVLNode<Data>* child = node->getRChild();
+	if (child != NULL) {
+		node->setRChild(NULL);
+		child->setParent(NULL);
 	}
+	return child;
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+AVLNode<Data>* AVLTree<Data, KeyOf, Compare, Allocator>::rebalanceUp(AVLNode<Data>* node)
+{
+	AVLNode<Data>* top = node;
+	while (node != NULL)
+	{
+		node->calculateStats();
+		if (node->getBF() > 1 || node->getBF() < -1)
+			node = rotate(node);
 
-	this->highest = temp;
+		top = node;
+		node = node->getParent();
+	}
+
+	return top;
 }
 
-template<typename Data>
-int AVLTree<Data>::inorder(AVLNode<Data>* p, Data** arr, int numOfNodes, int i)
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+AVLNode<Data>* AVLTree<Data, KeyOf, Compare, Allocator>::joinNodes(AVLNode<Data>* left, AVLNode<Data>* pivot, AVLNode<Data>* right)
+{
+	int leftHeight = height_of(left);
+	int rightHeight = height_of(right);
+
+	if (leftHeight > rightHeight + 1) {
+		//hang pivot off left's right spine where the heights meet, the walk is O(height difference)
+		AVLNode<Data>* node = left;
+		while (height_of(node->getRChild()) > rightHeight + 1)
+			node = node->getRChild();
+
+		pivot->setLChild(node->getRChild());
+		pivot->setRChild(right);
+		node->setRChild(pivot);
+		return rebalanceUp(node);
+	}
+
+	if (rightHeight > leftHeight + 1) {
+		AVLNode<Data>* node = right;
+		while (height_of(node->getLChild()) > leftHeight + 1)
+			node = node->getLChild();
+
+		pivot->setRChild(node->getLChild());
+		pivot->setLChild(left);
+		node->setLChild(pivot);
+		return rebalanceUp(node);
+	}
+
+	pivot->setLChild(left);
+	pivot->setRChild(right);
+	pivot->setParent(NULL);
+	return pivot;
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+AVLNode<Data>* AVLTree<Data, KeyOf, Compare, Allocator>::splitNodes(AVLNode<Data>* node, const Key& key,
+	AVLNode<Data>** less, AVLNode<Data>** greater)
 {
-	if (p == NULL) return i;
+	if (node == NULL) {
+		*less = NULL;
+		*greater = NULL;
+		return NULL;
+	}
 
-	i = AVLTree<Data>::inorder(p->getLChild(), arr, numOfNodes, i);
-	if (i == numOfNodes) return i;
-	arr[i++] = p->getData();
-	i = AVLTree<Data>::inorder(p->getRChild(), arr, numOfNodes, i);
+	AVLNode<Data>* left = detach_left(node);
+	AVLNode<Data>* right = detach_right(node);
 
-	return i;
+	int cmp = compareTo(node, key);
+	if (cmp == 0) {
+		*less = left;
+		*greater = right;
+		return node;
+	}
+
+	AVLNode<Data>* found;
+	AVLNode<Data>* part;
+	if (cmp > 0) {
+		found = splitNodes(left, key, less, &part);
+		*greater = joinNodes(part, node, right);
+	}
+	else {
+		found = splitNodes(right, key, &part, greater);
+		*less = joinNodes(left, node, part);
+	}
+
+	return found;
 }
 
-template<typename Data>
-Data** AVLTree<Data>::orderedArray(int size) {
-	Data** arr = new Data*[size];
-	this->inorder(this->root, arr, size);
-	return arr;
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+AVLNode<Data>* AVLTree<Data, KeyOf, Compare, Allocator>::unionNodes(AVLNode<Data>* driver, AVLNode<Data>* other,
+	bool driverIsThis, int& duplicates)
+{
+	if (driver == NULL)
+		return other;
+	if (other == NULL)
+		return driver;
+
+	AVLNode<Data>* driverLeft = detach_left(driver);
+	AVLNode<Data>* driverRight = detach_right(driver);
+
+	AVLNode<Data>* otherLeft;
+	AVLNode<Data>* otherRight;
+	AVLNode<Data>* same = splitNodes(other, KeyOf::key(*driver->getData()), &otherLeft, &otherRight);
+	if (same != NULL) {
+		duplicates++;
+		if (driverIsThis)
+			destroyNode(same);
+		else {
+			destroyNode(driver);
+			driver = same;
+		}
+	}
+
+	AVLNode<Data>* left = unionNodes(driverLeft, otherLeft, driverIsThis, duplicates);
+	AVLNode<Data>* right = unionNodes(driverRight, otherRight, driverIsThis, duplicates);
+	return joinNodes(left, driver, right);
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+void AVLTree<Data, KeyOf, Compare, Allocator>::merge(AVLTree& other)
+{
+	if (&other == this || other.root == NULL)
+		return;
+
+	allocator.absorb(other.allocator);
+
+	//compared before the union, which may destroy other's extremes as duplicates.
+	//a strictly greater (or lower) extreme of other is never a duplicate.
+	if (this->highest == NULL || compareTo(this->highest, KeyOf::key(*other.highest->getData())) < 0)
+		this->highest = other.highest;
+	if (this->lowest == NULL || compareTo(this->lowest, KeyOf::key(*other.lowest->getData())) > 0)
+		this->lowest = other.lowest;
+
+	//detached, so the rotations below never mistake a subtree root for the tree's root
+	AVLNode<Data>* mine = this->root;
+	this->root = NULL;
+
+	int duplicates = 0;
+	if (this->nodes_count <= other.nodes_count)
+		this->root = unionNodes(mine, other.root, true, duplicates);
+	else
+		this->root = unionNodes(other.root, mine, false, duplicates);
+
+	this->nodes_count += other.nodes_count - duplicates;
+	other.root = NULL;
+	other.nodes_count = 0;
+	other.highest = NULL;
+	other.lowest = NULL;
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+const int AVLTree<Data, KeyOf, Compare, Allocator>::getSize()
+{
+	return this->nodes_count;
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+template<typename K>
+int AVLTree<Data, KeyOf, Compare, Allocator>::rank(const K& key)
+{
+	int count = 0;
+	AVLNode<Data>* node = this->root;
+	while (node != NULL)
+	{
+		if (compareTo(node, key) > 0) {
+			node = node->getLChild();
+			continue;
+		}
+
+		//node and its whole left subtree are not greater than key
+		count += 1;
+		if (node->getLChild() != NULL)
+			count += node->getLChild()->getSize();
+		node = node->getRChild();
+	}
+
+	return count;
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+AVLNode<Data>* AVLTree<Data, KeyOf, Compare, Allocator>::selectNode(int k)
+{
+	if (k < 1 || k > this->nodes_count)
+		return NULL;
+
+	AVLNode<Data>* node = this->root;
+	while (node != NULL)
+	{
+		int leftSize = node->getLChild() != NULL ? node->getLChild()->getSize() : 0;
+		if (k == leftSize + 1)
+			return node;
+
+		if (k <= leftSize)
+			node = node->getLChild();
+		else {
+			k -= leftSize + 1;
+			node = node->getRChild();
+		}
+	}
+
+	return NULL;
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+Data* AVLTree<Data, KeyOf, Compare, Allocator>::select(int k)
+{
+	AVLNode<Data>* node = selectNode(k);
+	return node == NULL ? NULL : node->getData();
 }
 
 template<typename Data>
-static void deleteNodes(AVLNode<Data>* root)
+static void destructNodes(AVLNode<Data>* root)
 {
 	if (root == NULL)
 		return;
 
-	deleteNodes(root->getLChild());
-	deleteNodes(root->getRChild());
-	delete root;
+	destructNodes(root->getLChild());
+	destructNodes(root->getRChild());
+	root->~AVLNode<Data>();
 }
 
-template<typename Data>
-AVLTree<Data>::~AVLTree()
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+void AVLTree<Data, KeyOf, Compare, Allocator>::deleteNodes(AVLNode<Data>* node)
 {
-	deleteNodes(this->root);
+	if (node == NULL)
+		return;
+
+	deleteNodes(node->getLChild());
+	deleteNodes(node->getRChild());
+	destroyNode(node);
+}
+
+template<typename Data, typename KeyOf, typename Compare, typename Allocator>
+AVLTree<Data, KeyOf, Compare, Allocator>::~AVLTree()
+{
+	if (!allocator.releasable()) {
+		deleteNodes(this->root);
+		return;
+	}
+
+	//the whole pool goes at once, so nodes only need visiting if Data has a destructor to run
+	if (!std::is_trivially_destructible<Data>::value)
+		destructNodes(this->root);
+	allocator.release();
 }
 
 #endif //AVL_TREE
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "FileIO.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+int64_t tellFile(FILE* file)
+{
+#ifdef _WIN32
+    return _ftelli64(file);
+#else
+    return ftello(file);
+#endif
+}
+
+bool seekFile(FILE* file, int64_t offset, int origin)
+{
+#ifdef _WIN32
+    return _fseeki64(file, (__int64)offset, origin) == 0;
+#else
+    return fseeko(file, (off_t)offset, origin) == 0;
+#endif
+}
+
+int64_t remainingBytes(FILE* file)
+{
+    int64_t position = tellFile(file);
+    if (position < 0 || !seekFile(file, 0, SEEK_END))
+        return -1;
+    int64_t end = tellFile(file);
+    if (!seekFile(file, position, SEEK_SET))
+        return -1;
+    return end < 0 ? -1 : end - position;
+}
+
+bool truncateFile(FILE* file, int64_t size)
+{
+    if (fflush(file) != 0)
+        return false;
+#ifdef _WIN32
+    return _chsize_s(_fileno(file), (__int64)size) == 0;
+#else
+    return ftruncate(fileno(file), (off_t)size) == 0;
+#endif
+}
+
+bool flushToDisk(FILE* file)
+{
+    if (fflush(file) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool replaceFile(const char* from, const char* to)
+{
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+}
@@ -0,0 +1,21 @@
+#ifndef FILE_IO
+#define FILE_IO
+
+#include <cstdint>
+#include <cstdio>
+
+// file positions as 64-bit offsets, long is 32 bits on Windows; both return -1 / false on error
+int64_t tellFile(FILE* file);
+bool seekFile(FILE* file, int64_t offset, int origin);
+
+// bytes from the current position to the end of the file, -1 if they cannot be told
+int64_t remainingBytes(FILE* file);
+
+// cuts the file to size bytes, after flushing what is buffered
+bool truncateFile(FILE* file, int64_t size);
+// flushes file's buffers and asks the OS to put its content on disk
+bool flushToDisk(FILE* file);
+// renames from to to, replacing to in one step if it exists
+bool replaceFile(const char* from, const char* to);
+
+#endif
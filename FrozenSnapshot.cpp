@@ -0,0 +1,261 @@
+#include "FrozenSnapshot.h"
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char FROZEN_MAGIC[8] = { 'P', 'M', 'F', 'R', 'O', 'Z', '\0', '\0' };
+
+
+/* ------------------------------------------ Helper Functions ------------------------------------------ */
+
+// maps the whole file read-only, returns NULL on failure
+static void* mapFile(const char* path, size_t* length, void** fileHandle, void** mapHandle)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (map == NULL) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    void* view = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    if (view == NULL) {
+        CloseHandle(map);
+        CloseHandle(file);
+        return NULL;
+    }
+
+    *length = (size_t)size.QuadPart;
+    *fileHandle = file;
+    *mapHandle = map;
+    return view;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    // the mapping keeps its own reference to the file
+    void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED)
+        return NULL;
+
+    *length = (size_t)info.st_size;
+    *fileHandle = NULL;
+    *mapHandle = NULL;
+    return view;
+#endif
+}
+
+static void unmapFile(void* view, size_t length, void* fileHandle, void* mapHandle)
+{
+#ifdef _WIN32
+    (void)length;
+    UnmapViewOfFile(view);
+    CloseHandle((HANDLE)mapHandle);
+    CloseHandle((HANDLE)fileHandle);
+#else
+    (void)fileHandle;
+    (void)mapHandle;
+    munmap(view, length);
+#endif
+}
+
+
+/* ------------------------------------------ FrozenSnapshot Functions ------------------------------------------ */
+
+
+FrozenSnapshot::FrozenSnapshot()
+{
+    mapping = NULL;
+    length = 0;
+    fileHandle = NULL;
+    mapHandle = NULL;
+    header = NULL;
+    playersByLevel = NULL;
+    groups = NULL;
+    groupPlayers = NULL;
+    groupsHighest = NULL;
+}
+
+FrozenSnapshot::~FrozenSnapshot()
+{
+    unmap();
+}
+
+void FrozenSnapshot::unmap()
+{
+    if (mapping != NULL)
+        unmapFile(mapping, length, fileHandle, mapHandle);
+
+    mapping = NULL;
+    length = 0;
+    fileHandle = NULL;
+    mapHandle = NULL;
+    header = NULL;
+}
+
+StatusType FrozenSnapshot::Open(const char* path)
+{
+    if (path == NULL)
+        return INVALID_INPUT;
+
+    unmap();
+    mapping = mapFile(path, &length, &fileHandle, &mapHandle);
+    if (mapping == NULL)
+        return FAILURE;
+
+    const char* bytes = (const char*)mapping;
+    const FrozenHeader* head = (const FrozenHeader*)bytes;
+    if (length < sizeof(FrozenHeader) || memcmp(head->magic, FROZEN_MAGIC, sizeof(head->magic)) != 0
+        || head->version != FROZEN_VERSION || head->numOfGroups < 0 || head->numOfPlayers < 0
+        || head->numOfNonEmpty < 0 || head->numOfNonEmpty > head->numOfGroups) {
+        unmap();
+        return FAILURE;
+    }
+
+    size_t players = (size_t)head->numOfPlayers;
+    size_t offset = sizeof(FrozenHeader);
+    playersByLevel = (const int32_t*)(bytes + offset);
+    offset += players * sizeof(int32_t);
+    groups = (const FrozenGroup*)(bytes + offset);
+    offset += (size_t)head->numOfGroups * sizeof(FrozenGroup);
+    groupPlayers = (const int32_t*)(bytes + offset);
+    offset += players * sizeof(int32_t);
+    groupsHighest = (const int32_t*)(bytes + offset);
+    offset += (size_t)head->numOfNonEmpty * sizeof(int32_t);
+    if (offset != length) {
+        unmap();
+        return FAILURE;
+    }
+
+    // only the group index is checked, the queries index the other sections through it. The
+    // ranges must tile groupPlayers exactly, so every player belongs to one group
+    int nonEmpty = 0;
+    int end = 0;
+    for (int g = 0; g < head->numOfGroups; g++) {
+        const FrozenGroup& group = groups[g];
+        if ((g > 0 && group.id <= groups[g - 1].id) || group.id <= 0 || group.start != end
+            || group.size < 0 || group.size > head->numOfPlayers - end) {
+            unmap();
+            return FAILURE;
+        }
+        end += group.size;
+        if (group.size > 0)
+            nonEmpty++;
+    }
+    if (end != head->numOfPlayers || nonEmpty != head->numOfNonEmpty) {
+        unmap();
+        return FAILURE;
+    }
+
+    header = head;
+    return SUCCESS;
+}
+
+const FrozenGroup* FrozenSnapshot::findGroup(int GroupID) const
+{
+    int low = 0;
+    int high = header->numOfGroups - 1;
+    while (low <= high) {
+        int middle = low + (high - low) / 2;
+        if (groups[middle].id == GroupID)
+            return &groups[middle];
+        if (groups[middle].id < GroupID)
+            low = middle + 1;
+        else
+            high = middle - 1;
+    }
+
+    return NULL;
+}
+
+StatusType FrozenSnapshot::GetHighestLevel(int GroupID, int* PlayerID) const
+{
+    if (GroupID == 0 || !PlayerID)
+        return INVALID_INPUT;
+    if (header == NULL)
+        return FAILURE;
+
+    if (GroupID < 0) {
+        *PlayerID = header->numOfPlayers == 0 ? -1 : playersByLevel[0];
+        return SUCCESS;
+    }
+
+    const FrozenGroup* group = findGroup(GroupID);
+    if (group == NULL)
+        return FAILURE;
+
+    *PlayerID = group->size == 0 ? -1 : groupPlayers[group->start];
+    return SUCCESS;
+}
+
+StatusType FrozenSnapshot::GetAllPlayersByLevel(int GroupID, int** Players, int* numOfPlayers) const
+{
+    if (GroupID == 0 || !Players || !numOfPlayers)
+        return INVALID_INPUT;
+    if (header == NULL)
+        return FAILURE;
+
+    const int32_t* source = playersByLevel;
+    int count = header->numOfPlayers;
+    if (GroupID > 0) {
+        const FrozenGroup* group = findGroup(GroupID);
+        if (group == NULL)
+            return FAILURE;
+
+        source = groupPlayers + group->start;
+        count = group->size;
+    }
+
+    // the arrays are already in answer order, a single copy out of the mapping
+    int* players = (int*)malloc(count * sizeof(int));
+    if (players == NULL && count > 0)
+        return ALLOCATION_ERROR;
+    if (count > 0)
+        memcpy(players, source, count * sizeof(int));
+
+    *numOfPlayers = count;
+    *Players = players;
+    return SUCCESS;
+}
+
+StatusType FrozenSnapshot::GetGroupsHighestLevel(int numOfGroups, int** Players) const
+{
+    if (numOfGroups < 1 || !Players)
+        return INVALID_INPUT;
+    if (header == NULL || numOfGroups > header->numOfNonEmpty)
+        return FAILURE;
+
+    int* highestPlayers = (int*)malloc(numOfGroups * sizeof(int));
+    if (highestPlayers == NULL)
+        return ALLOCATION_ERROR;
+    memcpy(highestPlayers, groupsHighest, numOfGroups * sizeof(int));
+
+    *Players = highestPlayers;
+    return SUCCESS;
+}
@@ -0,0 +1,69 @@
+#ifndef FROZEN_SNAPSHOT
+#define FROZEN_SNAPSHOT
+
+#include "library1.h"
+#include <cstddef>
+#include <cstdint>
+
+// frozen snapshot file: the header followed by the sections below, in this order and with no
+// padding, all in host byte order:
+//   int32_t      playersByLevel[numOfPlayers]   player ids, highest level first
+//   FrozenGroup  groups[numOfGroups]            ascending by id, their ranges back to back from 0
+//   int32_t      groupPlayers[numOfPlayers]     each group's range holds its player ids, highest level first
+//   int32_t      groupsHighest[numOfNonEmpty]   highest player of each non-empty group, ascending by group id
+struct FrozenHeader
+{
+    char magic[8];
+    uint32_t version;
+    int32_t numOfGroups;
+    int32_t numOfPlayers;
+    int32_t numOfNonEmpty;
+};
+
+struct FrozenGroup
+{
+    int32_t id;
+    int32_t start; // first index of the group in groupPlayers
+    int32_t size;
+};
+
+extern const char FROZEN_MAGIC[8];
+const uint32_t FROZEN_VERSION = 1;
+
+/// <summary>
+/// Read-only query engine over a frozen snapshot written by PlayersManager::SaveFrozenSnapshot.
+/// The file is mapped, not read: the queries run on the mapped arrays, pages are loaded on first
+/// touch and shared by every process that maps the same file.
+/// </summary>
+class FrozenSnapshot
+{
+    void* mapping;
+    size_t length;
+    void* fileHandle; // only used on Windows, where the mapping needs its own handles
+    void* mapHandle;
+
+    const FrozenHeader* header;
+    const int32_t* playersByLevel;
+    const FrozenGroup* groups;
+    const int32_t* groupPlayers;
+    const int32_t* groupsHighest;
+
+    const FrozenGroup* findGroup(int GroupID) const; // NULL if there is no such group
+    void unmap();
+
+public:
+    FrozenSnapshot();
+    ~FrozenSnapshot();
+    FrozenSnapshot(const FrozenSnapshot&) = delete;
+    FrozenSnapshot& operator=(const FrozenSnapshot&) = delete;
+
+    // FAILURE if the file cannot be mapped or does not hold a valid frozen snapshot
+    StatusType Open(const char* path);
+
+    // same contracts as the PlayersManager queries
+    StatusType GetHighestLevel(int GroupID, int* PlayerID) const;
+    StatusType GetAllPlayersByLevel(int GroupID, int** Players, int* numOfPlayers) const;
+    StatusType GetGroupsHighestLevel(int numOfGroups, int** Players) const;
+};
+
+#endif // FROZEN_SNAPSHOT
@@ -0,0 +1,233 @@
+#ifndef NODE_POOL
+#define NODE_POOL
+#include <cstddef>
+#include <new>
+
+/// <summary>
+/// Slab allocator for fixed size tree nodes.
+/// Cells are carved out of slabs that double in size (up to MAX_SLAB_CELLS), freed cells are
+/// kept on a freelist and reused by the next allocation. Memory goes back to the system only
+/// in release() or in the destructor, one slab at a time, so dropping a whole tree costs
+/// O(#slabs) instead of one free per node.
+/// </summary>
+/// <typeparam name="Node">type of the objects that will be constructed in the cells</typeparam>
+template <typename Node>
+class NodePool
+{
+    union Cell {
+        Cell* next; //valid while the cell is on the freelist
+        alignas(Node) unsigned char storage[sizeof(Node)];
+    };
+
+    struct Slab {
+        Slab* next;
+        Cell* cells;
+    };
+
+    static const size_t FIRST_SLAB_CELLS = 16;
+    static const size_t MAX_SLAB_CELLS = 16384;
+
+    Slab* slabs;
+    Cell* freeList;
+    Cell* freeTail; //last cell of the freelist, so another pool's freelist can be spliced in O(1)
+    Cell* bump; //next never used cell of the slab being carved
+    Cell* bumpEnd;
+    size_t nextSlabCells;
+    size_t reserved; //allocations left that must come from the bump run
+
+    void addSlab(size_t cells);
+
+public:
+    NodePool();
+    ~NodePool();
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    //returns uninitialized memory for one Node, throws bad_alloc
+    void* allocate();
+    void deallocate(void* cell);
+    //the next count allocate() calls return consecutive never used cells, so a tree built in
+    //key order is laid out in key order. Throws bad_alloc, afterwards those calls cannot fail.
+    void reserve(size_t count);
+
+    //true if release() may be used to drop every cell at once
+    bool releasable() const { return true; }
+    //returns all slabs to the system. Objects still living in the cells are not destructed.
+    void release();
+    //takes over other's slabs and free cells, so cells allocated by other now belong to this pool
+    //and other is left empty. Costs O(other's #slabs) plus at most one slab of unused cells.
+    void absorb(NodePool& other);
+};
+
+/// <summary>
+/// Allocator with the NodePool interface that uses the global new/delete for every node.
+/// </summary>
+template <typename Node>
+class HeapAllocator
+{
+public:
+    void* allocate() { return ::operator new(sizeof(Node)); }
+    void deallocate(void* cell) { ::operator delete(cell); }
+    void reserve(size_t) {}
+    bool releasable() const { return false; }
+    void release() {}
+    void absorb(HeapAllocator&) {}
+};
+
+
+template<typename Node>
+NodePool<Node>::NodePool()
+{
+	slabs = NULL;
+	freeList = NULL;
+	freeTail = NULL;
+	bump = NULL;
+	bumpEnd = NULL;
+	nextSlabCells = FIRST_SLAB_CELLS;
+	reserved = 0;
+}
+
+template<typename Node>
+NodePool<Node>::~NodePool()
+{
+	release();
+}
+
+template<typename Node>
+void NodePool<Node>::addSlab(size_t cells)
+{
+	Slab* slab = new Slab;
+	try {
+		slab->cells = new Cell[cells];
+	}
+	catch (const std::bad_alloc&) {
+		delete slab;
+		throw;
+	}
+
+	slab->next = slabs;
+	slabs = slab;
+	bump = slab->cells;
+	bumpEnd = slab->cells + cells;
+
+	if (nextSlabCells < MAX_SLAB_CELLS)
+		nextSlabCells *= 2;
+}
+
+template<typename Node>
+void* NodePool<Node>::allocate()
+{
+	if (reserved > 0) {
+		reserved--;
+		return (bump++)->storage;
+	}
+
+	if (freeList != NULL) {
+		Cell* cell = freeList;
+		freeList = cell->next;
+		if (freeList == NULL)
+			freeTail = NULL;
+		return cell->storage;
+	}
+
+	if (bump == bumpEnd)
+		addSlab(nextSlabCells);
+
+	return (bump++)->storage;
+}
+
+template<typename Node>
+void NodePool<Node>::deallocate(void* cell)
+{
+	if (cell == NULL)
+		return;
+
+	Cell* freed = static_cast<Cell*>(cell);
+	freed->next = freeList;
+	if (freeList == NULL)
+		freeTail = freed;
+	freeList = freed;
+}
+
+template<typename Node>
+void NodePool<Node>::reserve(size_t count)
+{
+	if ((size_t)(bumpEnd - bump) < count) {
+		size_t cells = count > nextSlabCells ? count : nextSlabCells;
+		Cell* oldBump = bump;
+		Cell* oldBumpEnd = bumpEnd;
+		addSlab(cells);
+
+		//the rest of the old run is too short, it is reused through the freelist
+		while (oldBump != oldBumpEnd)
+			deallocate((oldBump++)->storage);
+	}
+
+	reserved = count;
+}
+
+template<typename Node>
+void NodePool<Node>::release()
+{
+	while (slabs != NULL) {
+		Slab* next = slabs->next;
+		delete[] slabs->cells;
+		delete slabs;
+		slabs = next;
+	}
+
+	freeList = NULL;
+	freeTail = NULL;
+	bump = NULL;
+	bumpEnd = NULL;
+	nextSlabCells = FIRST_SLAB_CELLS;
+	reserved = 0;
+}
+
+template<typename Node>
+void NodePool<Node>::absorb(NodePool& other)
+{
+	if (&other == this || other.slabs == NULL)
+		return;
+
+	//the bump runs may be swapped below, so pending reservations are dropped
+	reserved = 0;
+	other.reserved = 0;
+
+	Slab* lastSlab = other.slabs;
+	while (lastSlab->next != NULL)
+		lastSlab = lastSlab->next;
+	lastSlab->next = slabs;
+	slabs = other.slabs;
+
+	if (other.freeList != NULL) {
+		other.freeTail->next = freeList;
+		if (freeList == NULL)
+			freeTail = other.freeTail;
+		freeList = other.freeList;
+	}
+
+	//keep bumping through the larger unused run, the smaller one (at most one slab) goes on the freelist
+	if (other.bumpEnd - other.bump > bumpEnd - bump) {
+		Cell* tmp = bump;
+		bump = other.bump;
+		other.bump = tmp;
+		tmp = bumpEnd;
+		bumpEnd = other.bumpEnd;
+		other.bumpEnd = tmp;
+	}
+	while (other.bump != other.bumpEnd)
+		deallocate((other.bump++)->storage);
+
+	if (other.nextSlabCells > nextSlabCells)
+		nextSlabCells = other.nextSlabCells;
+
+	other.slabs = NULL;
+	other.freeList = NULL;
+	other.freeTail = NULL;
+	other.bump = NULL;
+	other.bumpEnd = NULL;
+	other.nextSlabCells = FIRST_SLAB_CELLS;
+}
+
+#endif //NODE_POOL
@@ -0,0 +1,222 @@
+#include "OperationLog.h"
+#include "FileIO.h"
+#include <cstring>
+#include <new>
+
+static const char LOG_MAGIC[8] = { 'P', 'M', 'O', 'P', 'L', 'O', 'G', '\0' };
+static const uint32_t LOG_VERSION = 1;
+
+
+/* ------------------------------------------ Helper Functions ------------------------------------------ */
+
+// FNV-1a over the record's fields
+static uint32_t recordChecksum(const LogRecord& record)
+{
+    uint32_t words[4] = { record.op, (uint32_t)record.args[0], (uint32_t)record.args[1], (uint32_t)record.args[2] };
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < 4; i++) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            hash ^= (words[i] >> shift) & 0xFF;
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+static bool readHeader(FILE* file, LogHeader* header)
+{
+    return fread(header, sizeof(LogHeader), 1, file) == 1
+        && memcmp(header->magic, LOG_MAGIC, sizeof(header->magic)) == 0
+        && header->version == LOG_VERSION;
+}
+
+
+
+/* ------------------------------------------ OperationLog Functions ------------------------------------------ */
+
+
+OperationLog::OperationLog()
+{
+    file = NULL;
+    pending = NULL;
+    numOfPending = 0;
+    batchSize = 0;
+    failed = false;
+}
+
+OperationLog::~OperationLog()
+{
+    Close();
+}
+
+StatusType OperationLog::start(FILE* opened, int batch)
+{
+    LogRecord* records = new (std::nothrow) LogRecord[batch];
+    if (records == NULL) {
+        fclose(opened);
+        return ALLOCATION_ERROR;
+    }
+
+    file = opened;
+    pending = records;
+    numOfPending = 0;
+    batchSize = batch;
+    failed = false;
+    return SUCCESS;
+}
+
+StatusType OperationLog::Open(const char* logPath, uint64_t sequence, int batch)
+{
+    if (logPath == NULL || batch < 1)
+        return INVALID_INPUT;
+
+    FILE* existing = fopen(logPath, "r+b");
+    if (existing == NULL)
+        return Create(logPath, sequence, batch);
+
+    Close();
+
+    // new records go right after the last valid one. Whatever follows it is cut off first: a torn
+    // or corrupt record may have valid-looking stale records after it, which the new records
+    // would otherwise only partly overwrite and a later recovery would replay
+    LogHeader header;
+    if (!readHeader(existing, &header)) {
+        fclose(existing);
+        return FAILURE;
+    }
+
+    uint64_t count = 0;
+    LogRecord record;
+    while (fread(&record, sizeof(LogRecord), 1, existing) == 1 && record.checksum == recordChecksum(record))
+        count++;
+
+    int64_t end = (int64_t)(sizeof(LogHeader) + count * sizeof(LogRecord));
+    if (header.baseSequence + count != sequence
+        || !truncateFile(existing, end) || !flushToDisk(existing) || !seekFile(existing, end, SEEK_SET)) {
+        fclose(existing);
+        return FAILURE;
+    }
+
+    path = logPath;
+    return start(existing, batch);
+}
+
+StatusType OperationLog::Create(const char* logPath, uint64_t sequence, int batch)
+{
+    if (logPath == NULL || batch < 1)
+        return INVALID_INPUT;
+
+    Close();
+
+    FILE* created = fopen(logPath, "wb");
+    if (created == NULL)
+        return FAILURE;
+
+    LogHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LOG_MAGIC, sizeof(header.magic));
+    header.version = LOG_VERSION;
+    header.baseSequence = sequence;
+    if (fwrite(&header, sizeof(header), 1, created) != 1 || !flushToDisk(created)) {
+        fclose(created);
+        return FAILURE;
+    }
+
+    path = logPath;
+    return start(created, batch);
+}
+
+void OperationLog::Append(LogOp op, int arg1, int arg2, int arg3)
+{
+    if (file == NULL || failed)
+        return;
+
+    LogRecord& record = pending[numOfPending++];
+    record.op = (uint32_t)op;
+    record.args[0] = arg1;
+    record.args[1] = arg2;
+    record.args[2] = arg3;
+    record.checksum = recordChecksum(record);
+
+    if (numOfPending == batchSize)
+        Commit();
+}
+
+StatusType OperationLog::Commit()
+{
+    if (file == NULL)
+        return SUCCESS;
+    if (failed)
+        return FAILURE;
+
+    if (numOfPending > 0) {
+        if (fwrite(pending, sizeof(LogRecord), numOfPending, file) != (size_t)numOfPending || !flushToDisk(file)) {
+            failed = true;
+            return FAILURE;
+        }
+        numOfPending = 0;
+    }
+
+    return SUCCESS;
+}
+
+StatusType OperationLog::Close()
+{
+    if (file == NULL)
+        return SUCCESS;
+
+    StatusType result = Commit();
+    if (fclose(file) != 0)
+        result = FAILURE;
+
+    delete[] pending;
+    file = NULL;
+    pending = NULL;
+    numOfPending = 0;
+    return result;
+}
+
+OperationLog::Reader::~Reader()
+{
+    if (file != NULL)
+        fclose(file);
+}
+
+StatusType OperationLog::Reader::Open(const char* logPath)
+{
+    if (logPath == NULL)
+        return INVALID_INPUT;
+
+    file = fopen(logPath, "rb");
+    if (file == NULL)
+        return FAILURE;
+
+    LogHeader header;
+    if (!readHeader(file, &header)) {
+        fclose(file);
+        file = NULL;
+        return FAILURE;
+    }
+
+    baseSequence = header.baseSequence;
+    done = false;
+    return SUCCESS;
+}
+
+int OperationLog::Reader::Read(LogRecord* records, int max)
+{
+    if (file == NULL || done)
+        return 0;
+
+    int count = (int)fread(records, sizeof(LogRecord), max, file);
+    for (int i = 0; i < count; i++) {
+        if (records[i].checksum != recordChecksum(records[i])) {
+            done = true;
+            return i;
+        }
+    }
+
+    if (count < max)
+        done = true;
+    return count;
+}
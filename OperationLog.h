@@ -0,0 +1,97 @@
+#ifndef OPERATION_LOG
+#define OPERATION_LOG
+
+#include "library1.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// the mutating calls, as they are recorded in the log
+enum class LogOp : uint32_t {
+    ADD_GROUP = 1,
+    ADD_PLAYER,
+    REMOVE_PLAYER,
+    REPLACE_GROUP,
+    INCREASE_LEVEL
+};
+
+// one operation, with the arguments of its call in order; unused arguments are 0
+struct LogRecord
+{
+    uint32_t op;
+    int32_t args[3];
+    uint32_t checksum; // of the fields above, a torn or garbage tail fails it
+};
+
+// log file: the header, then one LogRecord per successful mutation. The record at index i is the
+// mutation number baseSequence + i of the manager's history, see PlayersManager::Checkpoint.
+struct LogHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t baseSequence;
+};
+
+/// <summary>
+/// Append-only write-ahead log with group commit. Records are collected in memory and written
+/// and flushed to disk together once batchSize of them are pending or on Commit(), so the cost of
+/// the flush is shared by the whole batch. A crash loses at most the records not yet committed.
+/// </summary>
+class OperationLog
+{
+    std::string path;
+    FILE* file;
+    LogRecord* pending;
+    int numOfPending;
+    int batchSize;
+    bool failed; // a write failed, nothing is appended until the log is created again
+
+    StatusType start(FILE* opened, int batch);
+
+public:
+    OperationLog();
+    ~OperationLog();
+    OperationLog(const OperationLog&) = delete;
+    OperationLog& operator=(const OperationLog&) = delete;
+
+    // appends to the log at path, which must end at sequence; creates it if there is none
+    StatusType Open(const char* path, uint64_t sequence, int batchSize);
+    // starts an empty log at path whose first record will be number sequence, replacing any log there
+    StatusType Create(const char* path, uint64_t sequence, int batchSize);
+    bool IsOpen() const { return file != NULL; }
+    const std::string& GetPath() const { return path; }
+    int GetBatchSize() const { return batchSize; }
+
+    // commits the batch once it is full; an I/O error is reported by the next Commit()
+    void Append(LogOp op, int arg1, int arg2 = 0, int arg3 = 0);
+    // writes the pending records and waits until they are on disk
+    StatusType Commit();
+    // commits and closes
+    StatusType Close();
+
+    /// <summary>
+    /// Sequential reader of a log file, for recovery. Stops at the first record that fails its
+    /// checksum, which is where a crash cut the log.
+    /// </summary>
+    class Reader
+    {
+        FILE* file;
+        uint64_t baseSequence;
+        bool done;
+
+    public:
+        Reader() : file(NULL), baseSequence(0), done(false) {}
+        ~Reader();
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        // FAILURE if path does not exist or is not a log
+        StatusType Open(const char* path);
+        uint64_t GetBaseSequence() const { return baseSequence; }
+        // reads up to max valid records, returns how many were read, 0 at the end of the log
+        int Read(LogRecord* records, int max);
+    };
+};
+
+#endif // OPERATION_LOG
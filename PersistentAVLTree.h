@@ -0,0 +1,379 @@
+#ifndef PERSISTENT_AVL_TREE
+#define PERSISTENT_AVL_TREE
+#include "AVLTree.h"
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+/// <summary>
+/// Persistent (path-copying) AVL tree. snapshot() is O(1) and returns a view that never changes;
+/// an update then copies only the nodes on the paths it touches that some view still shares, and
+/// changes the others in place. Nodes are reference counted by the parents and roots pointing at
+/// them, so a view can be read and released on any thread while the tree keeps changing.
+/// There are no parent links, so unlike AVLTree no cursor or node pointer outlives an update.
+/// </summary>
+/// <typeparam name="Data">default constructible and copyable</typeparam>
+/// <typeparam name="KeyOf">see AVLTree</typeparam>
+/// <typeparam name="Compare">see AVLTree</typeparam>
+template <typename Data, typename KeyOf = IdentityKey<Data>, typename Compare = ThreeWayCompare>
+class PersistentAVLTree
+{
+public:
+	typedef typename KeyOf::Key Key;
+
+	struct Node
+	{
+		Data data;
+		Node* left;
+		Node* right;
+		int height;
+		int size;
+		std::atomic<int> refs;
+	};
+
+	/// <summary>
+	/// Frozen view of the tree as it was when the snapshot was taken.
+	/// </summary>
+	class Snapshot
+	{
+		Node* root;
+	public:
+		explicit Snapshot(Node* root) : root(root) { retain(root); }
+		Snapshot(const Snapshot& other) : root(other.root) { retain(root); }
+		Snapshot& operator=(const Snapshot&) = delete;
+		~Snapshot() { release(root); }
+
+		int getSize() const { return sizeOf(root); }
+		//calls visit(data) on up to count data, from the offset-th highest (0-based) down.
+		//O(log n + count), returns how many were visited
+		template <typename Visit>
+		int visitDescending(int offset, int count, Visit visit) const;
+	};
+
+private:
+	Node* root;
+	Node* spare; //preallocated nodes chained through left, so an update never fails halfway
+	int numOfSpare;
+
+	static int heightOf(const Node* node) { return node != NULL ? node->height : 0; }
+	static int sizeOf(const Node* node) { return node != NULL ? node->size : 0; }
+	static void retain(Node* node) {
+		if (node != NULL) node->refs.fetch_add(1, std::memory_order_relaxed);
+	}
+	//drops one reference, and frees the node and releases its children if it was the last
+	static void release(Node* node);
+	template <typename K>
+	static int compareTo(const Node* node, const K& key) {
+		return Compare::compare(KeyOf::key(node->data), key);
+	}
+	static void update(Node* node) {
+		node->height = 1 + std::max(heightOf(node->left), heightOf(node->right));
+		node->size = 1 + sizeOf(node->left) + sizeOf(node->right);
+	}
+
+	//every update first makes sure it has enough spare nodes for its worst case
+	bool refill(int count);
+	Node* takeSpare();
+	//returns a node this version may change in place: node itself if nothing else refers to it,
+	//else a copy, which takes over the reference to node it replaces
+	Node* own(Node* node);
+	//the functions below take an owned node and return the new subtree root
+	Node* rotateLeft(Node* node);
+	Node* rotateRight(Node* node);
+	Node* balance(Node* node);
+	Node* insertInto(Node* node, const Data& data); //data's key must not be in the tree
+	template <typename K>
+	Node* eraseFrom(Node* node, const K& key); //key must be in the tree
+	template <typename It>
+	Node* buildNodes(It& first, int count);
+
+public:
+	PersistentAVLTree() : root(NULL), spare(NULL), numOfSpare(0) {}
+	~PersistentAVLTree();
+	PersistentAVLTree(const PersistentAVLTree&) = delete;
+	PersistentAVLTree& operator=(const PersistentAVLTree&) = delete;
+
+	//replaces the contents with [first, last), sorted by key with no duplicates. O(n)
+	template <typename It>
+	TreeResult buildFromSorted(It first, It last);
+	template <typename K>
+	const Data* findData(const K& key) const;
+	TreeResult insertNode(const Data& data);
+	template <typename K>
+	TreeResult deleteNode(const K& key);
+	int getSize() const { return sizeOf(root); }
+	//true if a snapshot still refers to the current version
+	bool isShared() const { return root != NULL && root->refs.load(std::memory_order_acquire) > 1; }
+
+	//O(1). Must not run at the same time as an update of this tree, reading and releasing the
+	//snapshot afterwards needs no synchronization
+	Snapshot snapshot() const { return Snapshot(root); }
+};
+
+
+template <typename Data, typename KeyOf, typename Compare>
+template <typename Visit>
+int PersistentAVLTree<Data, KeyOf, Compare>::Snapshot::visitDescending(int offset, int count, Visit visit) const
+{
+	if (offset < 0 || count <= 0 || offset >= sizeOf(root))
+		return 0;
+
+	//the stack holds the nodes still to be visited, each before its left subtree
+	Node* stack[64];
+	int top = 0;
+	Node* node = root;
+	while (node != NULL)
+	{
+		int rightSize = sizeOf(node->right);
+		if (offset <= rightSize)
+			stack[top++] = node;
+		if (offset == rightSize)
+			break;
+
+		if (offset < rightSize)
+			node = node->right;
+		else {
+			offset -= rightSize + 1;
+			node = node->left;
+		}
+	}
+
+	int visited = 0;
+	while (top > 0 && visited < count)
+	{
+		Node* current = stack[--top];
+		visit(current->data);
+		visited++;
+		for (Node* next = current->left; next != NULL; next = next->right)
+			stack[top++] = next;
+	}
+
+	return visited;
+}
+
+template <typename Data, typename KeyOf, typename Compare>
+PersistentAVLTree<Data, KeyOf, Compare>::~PersistentAVLTree()
+{
+	release(root);
+	while (spare != NULL) {
+		Node* next = spare->left;
+		delete spare;
+		spare = next;
+	}
+}
+
+template <typename Data, typename KeyOf, typename Compare>
+void PersistentAVLTree<Data, KeyOf, Compare>::release(Node* node)
+{
+	if (node == NULL || node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+
+	release(node->left);
+	release(node->right);
+	delete node;
+}
+
+template <typename Data, typename KeyOf, typename Compare>
+bool PersistentAVLTree<Data, KeyOf, Compare>::refill(int count)
+{
+	while (numOfSpare < count) {
+		Node* node = new (std::nothrow) Node;
+		if (node == NULL)
+			return false;
+		node->left = spare;
+		spare = node;
+		numOfSpare++;
+	}
+	return true;
+}
+
+template <typename Data, typename KeyOf, typename Compare>
+typename PersistentAVLTree<Data, KeyOf, Compare>::Node* PersistentAVLTree<Data, KeyOf, Compare>::takeSpare()
+{
+	Node* node = spare;
+	spare = spare->left;
+	numOfSpare--;
+	node->refs.store(1, std::memory_order_relaxed);
+	return node;
+}
+
+template <typename Data, typename KeyOf, typename Compare>
+typename PersistentAVLTree<Data, KeyOf, Compare>::Node* PersistentAVLTree<Data, KeyOf, Compare>::own(Node* node)
+{
+	if (node->refs.load(std::memory_order_acquire) == 1)
+		return node;
+
+	Node* copy = takeSpare();
+	copy->data = node->data;
+	copy->left = node->left;
+	copy->right = node->right;
+	copy->height = node->height;
+	copy->size = node->size;
+	retain(copy->left);
+	retain(copy->right);
+	release(node);
+	return copy;
+}
+
+template <typename Data, typename KeyOf, typename Compare>
+typename PersistentAVLTree<Data, KeyOf, Compare>::Node* PersistentAVLTree<Data, KeyOf, Compare>::rotateLeft(Node* node)
+{
+	Node* pivot = own(node->right);
+	node->right = pivot->left;
+	pivot->left = node;
+	update(node);
+	update(pivot);
+	return pivot;
+}
+
+template <typename Data, typename KeyOf, typename Compare>
+typename PersistentAVLTree<Data, KeyOf, Compare>::Node* PersistentAVLTree<Data, KeyOf, Compare>::rotateRight(Node* node)
+{
+	Node* pivot = own(node->left);
+	node->left = pivot->right;
+	pivot->right = node;
+	update(node);
+	update(pivot);
+	return pivot;
+}
+
+template <typename Data, typename KeyOf, typename Compare>
+typename PersistentAVLTree<Data, KeyOf, Compare>::Node* PersistentAVLTree<Data, KeyOf, Compare>::balance(Node* node)
+{
+	update(node);
+	int balanceFactor = heightOf(node->left) - heightOf(node->right);
+	if (balanceFactor > 1) {
+		if (heightOf(node->left->left) < heightOf(node->left->right))
+			node->left = rotateLeft(own(node->left));
+		return rotateRight(node);
+	}
+	if (balanceFactor < -1) {
+		if (heightOf(node->right->right) < heightOf(node->right->left))
+			node->right = rotateRight(own(node->right));
+		return rotateLeft(node);
+	}
+	return node;
+}
+
+template <typename Data, typename KeyOf, typename Compare>
+typename PersistentAVLTree<Data, KeyOf, Compare>::Node* PersistentAVLTree<Data, KeyOf, Compare>::insertInto(Node* node, const Data& data)
+{
+	if (node == NULL) {
+		Node* leaf = takeSpare();
+		leaf->data = data;
+		leaf->left = NULL;
+		leaf->right = NULL;
+		update(leaf);
+		return leaf;
+	}
+
+	node = own(node);
+	if (compareTo(node, KeyOf::key(data)) > 0)
+		node->left = insertInto(node->left, data);
+	else
+		node->right = insertInto(node->right, data);
+	return balance(node);
+}
+
+template <typename Data, typename KeyOf, typename Compare>
+template <typename K>
+typename PersistentAVLTree<Data, KeyOf, Compare>::Node* PersistentAVLTree<Data, KeyOf, Compare>::eraseFrom(Node* node, const K& key)
+{
+	node = own(node);
+	int result = compareTo(node, key);
+	if (result > 0)
+		node->left = eraseFrom(node->left, key);
+	else if (result < 0)
+		node->right = eraseFrom(node->right, key);
+	else if (node->left == NULL || node->right == NULL) {
+		//the child takes node's place, and node's reference to it
+		Node* child = node->left != NULL ? node->left : node->right;
+		retain(child);
+		release(node);
+		return child;
+	}
+	else {
+		//node takes its successor's data, then the successor is erased from the right subtree
+		const Node* successor = node->right;
+		while (successor->left != NULL)
+			successor = successor->left;
+		node->data = successor->data;
+		node->right = eraseFrom(node->right, KeyOf::key(node->data));
+	}
+
+	return balance(node);
+}
+
+template <typename Data, typename KeyOf, typename Compare>
+template <typename It>
+typename PersistentAVLTree<Data, KeyOf, Compare>::Node* PersistentAVLTree<Data, KeyOf, Compare>::buildNodes(It& first, int count)
+{
+	if (count == 0)
+		return NULL;
+
+	int leftCount = (count - 1) / 2;
+	Node* left = buildNodes(first, leftCount);
+	Node* node = takeSpare();
+	node->data = *first;
+	++first;
+	node->left = left;
+	node->right = buildNodes(first, count - 1 - leftCount);
+	update(node);
+	return node;
+}
+
+template <typename Data, typename KeyOf, typename Compare>
+template <typename It>
+TreeResult PersistentAVLTree<Data, KeyOf, Compare>::buildFromSorted(It first, It last)
+{
+	int count = (int)std::distance(first, last);
+	if (!refill(count))
+		return TreeResult::OUT_OF_MEMORY;
+
+	release(root);
+	root = buildNodes(first, count);
+	return TreeResult::SUCCESS;
+}
+
+template <typename Data, typename KeyOf, typename Compare>
+template <typename K>
+const Data* PersistentAVLTree<Data, KeyOf, Compare>::findData(const K& key) const
+{
+	const Node* node = root;
+	while (node != NULL)
+	{
+		int result = compareTo(node, key);
+		if (result == 0)
+			return &node->data;
+		node = result > 0 ? node->left : node->right;
+	}
+	return NULL;
+}
+
+template <typename Data, typename KeyOf, typename Compare>
+TreeResult PersistentAVLTree<Data, KeyOf, Compare>::insertNode(const Data& data)
+{
+	if (findData(KeyOf::key(data)) != NULL)
+		return TreeResult::NODE_ALREADY_EXISTS;
+	//a copy per level of the path and up to two more per rotation, and the new leaf
+	if (!refill(3 * (heightOf(root) + 1) + 1))
+		return TreeResult::OUT_OF_MEMORY;
+
+	root = insertInto(root, data);
+	return TreeResult::SUCCESS;
+}
+
+template <typename Data, typename KeyOf, typename Compare>
+template <typename K>
+TreeResult PersistentAVLTree<Data, KeyOf, Compare>::deleteNode(const K& key)
+{
+	if (findData(key) == NULL)
+		return TreeResult::NODE_DOESNT_EXISTS;
+	if (!refill(3 * (heightOf(root) + 1)))
+		return TreeResult::OUT_OF_MEMORY;
+
+	root = eraseFrom(root, key);
+	return TreeResult::SUCCESS;
+}
+
+#endif // PERSISTENT_AVL_TREE
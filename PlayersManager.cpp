@@ -1,111 +1,129 @@
 #include "PlayersManager.h"
+#include "FileIO.h"
+#include "FrozenSnapshot.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
 
 
 /* ------------------------------------------ Helper Functions ------------------------------------------ */
 
-static AVLNode<PlayerPointer>* arrayToTreeAux(PlayerPointer** arr, int start, int end)
+// stable LSD radix sort by the unsigned 32-bit digit(item), one byte per pass. A pass whose byte is
+// the same in every item is skipped, so small keys such as levels cost only one or two passes.
+template <typename T, typename Digit>
+static void radixSort(vector<T>& items, Digit digit)
 {
-	if (end < start)
-		return NULL;
-
-	int mid = (start + end) / 2;
-
-	AVLNode<PlayerPointer>* node = new AVLNode<PlayerPointer>(arr[mid]);
-	(arr[mid])->player->group_player = node;
-	
-	node->setLChild(arrayToTreeAux(arr, start, mid - 1));
-	node->setRChild(arrayToTreeAux(arr, mid + 1, end));
-
-	node->calculateStats();
-
-	return node;
+    vector<T> buffer(items.size());
+    for (int shift = 0; shift < 32; shift += 8) {
+        size_t count[257] = { 0 };
+        for (size_t i = 0; i < items.size(); i++)
+            count[((digit(items[i]) >> shift) & 0xFF) + 1]++;
+
+        bool skip = false;
+        for (int b = 1; b <= 256; b++)
+            skip = skip || count[b] == items.size();
+        if (skip)
+            continue;
+
+        for (int b = 0; b < 256; b++)
+            count[b + 1] += count[b];
+        for (size_t i = 0; i < items.size(); i++)
+            buffer[count[(digit(items[i]) >> shift) & 0xFF]++] = items[i];
+        items.swap(buffer);
+    }
 }
 
-static AVLTree<PlayerPointer>* arrayToTree(PlayerPointer** sortedArray, int size)
+// snapshot file: the header, the group ids, then one PlayerEntry per player, both ascending by id
+struct SnapshotHeader
 {
-	AVLNode<PlayerPointer>* root = arrayToTreeAux(sortedArray, 0, size - 1);
-	AVLTree<PlayerPointer>* tree = new AVLTree<PlayerPointer>(root, size);
-
-	return tree;
+    char magic[8];
+    uint32_t version;
+    int32_t numOfGroups;
+    int32_t numOfPlayers;
+    uint64_t sequence; // mutations the snapshot holds, the log is replayed from there
+};
+
+static const char SNAPSHOT_MAGIC[8] = { 'P', 'M', 'S', 'N', 'A', 'P', '\0', '\0' };
+static const uint32_t SNAPSHOT_VERSION = 2;
+
+template <typename T>
+static bool writeArray(FILE* file, const vector<T>& items)
+{
+    return items.empty() || fwrite(items.data(), sizeof(T), items.size(), file) == items.size();
 }
 
-static int mergeArrays(PlayerPointer** arr1, int size1, PlayerPointer** arr2, int size2, PlayerPointer** mergeArr)
+template <typename T>
+static bool readArray(FILE* file, vector<T>& items, int count)
 {
-	int i = 0, index1 = 0, index2 = 0;
-
-	while (index1 < size1 && index2 < size2)
-	{
-		if (*arr1[index1] < *arr2[index2]) {
-			mergeArr[i] = arr1[index1];
-			index1++;
-		}
-		else if (*arr1[index1] > *arr2[index2]) {
-			mergeArr[i] = arr2[index2];
-			index2++;
-		}
-		i++;
-	}
-
-	while (index1 < size1)
-	{
-		mergeArr[i] = arr1[index1];
-		index1++;
-		i++;
-	}
-
-	while (index2 < size2)
-	{
-		mergeArr[i] = arr2[index2];
-		index2++;
-		i++;
-	}
-
-	return i;
+    items.resize(count);
+    return items.empty() || fread(items.data(), sizeof(T), items.size(), file) == items.size();
 }
 
-static AVLTree<PlayerPointer>* mergeTrees(AVLTree<PlayerPointer>* tree1, AVLTree<PlayerPointer>* tree2)
-{
-	int size1 = tree1->getSize();
-	int size2 = tree2->getSize();
 
-	if (size1 > 0 && size2 > 0)
-	{
-		PlayerPointer** arr1 = tree1->orderedArray(size1);
-		PlayerPointer** arr2 = tree2->orderedArray(size2);
-		PlayerPointer** mergedArr = new PlayerPointer*[size1 + size2];
-		int mergeSize = mergeArrays(arr1, size1, arr2, size2, mergedArr);
-		AVLTree<PlayerPointer>* mergedTree = arrayToTree(mergedArr, mergeSize);
+/* ------------------------------------------ PlayersManager Functions ------------------------------------------ */
 
-		delete[] arr1;
-		delete[] arr2;
-		delete[] mergedArr;
 
-		return mergedTree;
-	}
+GroupSet* GroupSet::find(NodePool<GroupSet>& pool)
+{
+    GroupSet* root = this;
+    while (root->parent != nullptr)
+        root = root->parent;
+
+    // each set moved to the root drops its reference to the next one up the path, which is freed
+    // when that was the last (the root is held by its group, and this by the caller)
+    GroupSet* set = this;
+    while (set != root) {
+        GroupSet* next = set->parent;
+        if (set->refs == 0) {
+            pool.deallocate(set);
+            next->refs--;
+        }
+        else if (next != root) {
+            set->parent = root;
+            root->refs++;
+            next->refs--;
+        }
+        set = next;
+    }
 
-	else if (size1 > 0)
-	{
-		PlayerPointer** arr = tree1->orderedArray(size1);
-		AVLTree<PlayerPointer>* tree = arrayToTree(arr, tree1->getSize());
+    return root;
+}
 
-		delete[] arr;
-		return tree;
-	}
+GroupSet* GroupSet::findRoot()
+{
+    GroupSet* root = this;
+    while (root->parent != nullptr)
+        root = root->parent;
+    return root;
+}
 
-	else if (size2 > 0)
-	{
-		PlayerPointer** arr = tree2->orderedArray(size2);
-		AVLTree<PlayerPointer>* tree = arrayToTree(arr, tree2->getSize());
+GroupSet* GroupSet::unite(GroupSet* root1, GroupSet* root2)
+{
+    if (root1 == root2)
+        return root1;
 
-		delete[] arr;
-		return tree;
-	}
+    if (root1->rank < root2->rank) {
+        GroupSet* tmp = root1;
+        root1 = root2;
+        root2 = tmp;
+    }
+    root2->parent = root1;
+    root1->refs++;
+    if (root1->rank == root2->rank)
+        root1->rank++;
 
-	return new AVLTree<PlayerPointer>();
+    return root1;
 }
 
-
-/* ------------------------------------------ PlayersManager Functions ------------------------------------------ */
+void GroupSet::release(GroupSet* set, NodePool<GroupSet>& pool)
+{
+    while (set != nullptr && --set->refs == 0) {
+        GroupSet* parent = set->parent;
+        pool.deallocate(set);
+        set = parent;
+    }
+}
 
 
 Group& Group::operator=(const Group& g)
@@ -113,33 +131,29 @@ Group& Group::operator=(const Group& g)
     this->id = g.getGroupId();
     this->size = g.getSize();
     this->groupPointer = g.groupPointer;
+    this->set = g.set;
 
     if (this->groupPlayers) {
         delete groupPlayers;
         this->groupPlayers = nullptr;
     }
 
-    if (g.groupPlayers->getSize() > 0) {
-        PlayerPointer** playerArr = g.groupPlayers->orderedArray(g.groupPlayers->getSize());
-        this->groupPlayers = arrayToTree(playerArr, g.groupPlayers->getSize());
-        delete[] playerArr;
-        groupPlayers->updateHighest();
-        this->highest_player = groupPlayers->getHighest();
-    }
-    else {
-        this->groupPlayers = new AVLTree<PlayerPointer>();
-        this->highest_player = nullptr;
-    }
+    this->groupPlayers = new LevelTree();
+    auto relink = [](AVLNode<PlayerPointer>* node) { node->getData()->player->group_player = node; };
+    if (groupPlayers->buildFromSorted(g.groupPlayers->begin(), g.groupPlayers->end(), relink) != TreeResult::SUCCESS)
+        throw std::bad_alloc();
+    this->highest_player = groupPlayers->getHighest();
     return *this;
 }
 
 
-PlayersManager::PlayersManager()
+PlayersManager::PlayersManager(bool concurrent) : DataStructure(false), concurrent(concurrent), leaderboard(NULL)
 {
-	groupTree = new AVLTree<Group>();
-	NonEmptyGroups = new AVLTree<GroupPointer>();
-    playersById = new AVLTree<Player>();
-    playersByLevel = new AVLTree<PlayerPointer>();
+	groupTree = new GroupTree();
+	NonEmptyGroups = new GroupPointerTree();
+    playersById = new PlayerTree();
+    playersByLevel = new LevelTree();
+    sequence = 0;
 }
 
 PlayersManager::~PlayersManager()
@@ -148,6 +162,17 @@ PlayersManager::~PlayersManager()
 	delete NonEmptyGroups;
 	delete playersById;
 	delete playersByLevel;
+	delete leaderboard;
+}
+
+std::shared_lock<std::shared_mutex> PlayersManager::lockShared()
+{
+    return concurrent ? std::shared_lock<std::shared_mutex>(rwLock) : std::shared_lock<std::shared_mutex>();
+}
+
+std::unique_lock<std::shared_mutex> PlayersManager::lockExclusive()
+{
+    return concurrent ? std::unique_lock<std::shared_mutex>(rwLock) : std::unique_lock<std::shared_mutex>();
 }
 
 StatusType PlayersManager::AddGroup(int GroupID)
@@ -156,32 +181,55 @@ StatusType PlayersManager::AddGroup(int GroupID)
     
     if (groupTree->findData(GroupID))
         return FAILURE;
+    if (concurrent && !published.reserve(1))
+        return ALLOCATION_ERROR;
 
-    Group newGroup = Group(GroupID);
-    TreeResult insertResult = groupTree->insertNode(&newGroup, nullptr);
-    if (insertResult == TreeResult::NODE_ALREADY_EXISTS)
-        return FAILURE;
-    if (insertResult == TreeResult::OUT_OF_MEMORY)
+    GroupSet* set;
+    try {
+        set = new (groupSets.allocate()) GroupSet(nullptr);
+    }
+    catch (const bad_alloc&) {
         return ALLOCATION_ERROR;
+    }
+
+    AVLNode<Group>* group_node;
+    TreeResult insertResult = groupTree->emplaceNode(&group_node, GroupID);
+    if (insertResult != TreeResult::SUCCESS) {
+        groupSets.deallocate(set);
+        return insertResult == TreeResult::OUT_OF_MEMORY ? ALLOCATION_ERROR : FAILURE;
+    }
 
+    // group nodes are never swapped, so the set can point at the Group inside its node
+    set->group = group_node->getData();
+    set->group->set = set;
+
+    publishHighest(set->group);
+    logOperation(LogOp::ADD_GROUP, GroupID);
     return SUCCESS;
 }
 
-static StatusType addPlayerToGroup(Player* new_player, Group* group, 
-    AVLTree<Player>* playersById, AVLTree<PlayerPointer>* playersByLevel, AVLTree<GroupPointer>* NonEmptyGroups) 
+static StatusType addPlayerToGroup(const Player& new_player, Group* group, 
+    PlayerTree* playersById, LevelTree* playersByLevel, GroupPointerTree* NonEmptyGroups) 
 {    
-    PlayerPointer new_player_ptr = PlayerPointer();
-    new_player_ptr.player = new_player;
-
-    TreeResult res = playersByLevel->insertNode(&new_player_ptr, &new_player->player_level);
+    // the level trees point at the Player stored inside its playersById node
+    AVLNode<Player>* player_node;
+    TreeResult res = playersById->insertNode(new_player, &player_node);
     if (res == TreeResult::OUT_OF_MEMORY) {
         return ALLOCATION_ERROR;
     }
+    Player* player = player_node->getData();
+
+    PlayerPointer new_player_ptr = PlayerPointer(player);
 
-    TreeResult res1 = group->groupPlayers->insertNode(&new_player_ptr, &new_player->group_player);
+    TreeResult res1 = playersByLevel->insertNode(new_player_ptr, &player->player_level);
     if (res1 == TreeResult::OUT_OF_MEMORY) {
         return ALLOCATION_ERROR;
     }
+
+    TreeResult res2 = group->groupPlayers->insertNode(new_player_ptr, &player->group_player);
+    if (res2 == TreeResult::OUT_OF_MEMORY) {
+        return ALLOCATION_ERROR;
+    }
     group->highest_player = group->groupPlayers->getHighest();
     group->increaseSize();
 
@@ -189,21 +237,12 @@ static StatusType addPlayerToGroup(Player* new_player, Group* group,
         GroupPointer new_nonEmptyGroup = GroupPointer();
         new_nonEmptyGroup.group = group;
         
-        TreeResult res2 = NonEmptyGroups->insertNode(&new_nonEmptyGroup, &group->groupPointer);
-        if (res2 == TreeResult::OUT_OF_MEMORY) {
+        TreeResult res3 = NonEmptyGroups->insertNode(new_nonEmptyGroup, &group->groupPointer);
+        if (res3 == TreeResult::OUT_OF_MEMORY) {
             return ALLOCATION_ERROR;
         }
     }
 
-    AVLNode<Player>* player_node;
-    TreeResult res3 = playersById->insertNode(new_player, &player_node);
-    if (res3 == TreeResult::OUT_OF_MEMORY) {
-        return ALLOCATION_ERROR;
-    }
-
-    new_player->player_level->getData()->player = player_node->getData();
-    new_player->group_player->getData()->player = player_node->getData();
-
     return SUCCESS;
 }
 
@@ -212,14 +251,157 @@ StatusType PlayersManager::AddPlayer(int PlayerID, int GroupID, int Level)
     if(PlayerID <= 0 || GroupID <= 0 || Level < 0){
         return INVALID_INPUT;
     }
-    Group* group = groupTree->findData(GroupID);
-    
+    return addPlayer(PlayerID, groupTree->findData(GroupID), Level);
+}
+
+StatusType PlayersManager::addPlayer(int PlayerID, Group* group, int Level)
+{
     if(!group) return FAILURE;
     if (playersById->findData(PlayerID)) return FAILURE;
 
-    Player new_player = Player(PlayerID, Level, group);
+    Player new_player = Player(PlayerID, Level, group->set);
     
-    return addPlayerToGroup(&new_player, group, playersById, playersByLevel, NonEmptyGroups);
+    group->set->refs++;
+    StatusType result = addPlayerToGroup(new_player, group, playersById, playersByLevel, NonEmptyGroups);
+    if (result != SUCCESS && playersById->findData(PlayerID) == NULL)
+        group->set->refs--;
+    if (result == SUCCESS) {
+        leaderboardInsert(PlayerPointer::makeKey(Level, PlayerID));
+        publishHighest(group);
+        logOperation(LogOp::ADD_PLAYER, PlayerID, group->getGroupId(), Level);
+    }
+    return result;
+}
+
+StatusType PlayersManager::AddPlayersBulk(const PlayerEntry* Players, int numOfPlayers)
+{
+    if (numOfPlayers < 0 || (Players == NULL && numOfPlayers > 0))
+        return INVALID_INPUT;
+    for (int i = 0; i < numOfPlayers; i++) {
+        if (Players[i].PlayerID <= 0 || Players[i].GroupID <= 0 || Players[i].Level < 0)
+            return INVALID_INPUT;
+    }
+    if (numOfPlayers == 0)
+        return SUCCESS;
+
+    // every tree is first built on the side, nothing is touched until all allocations succeeded
+    PlayerTree newById;
+    LevelTree newByLevel;
+    GroupPointerTree newNonEmpty;
+    vector<LevelTree*> newGroupPlayers;
+    vector<Group*> groups; // touched groups, by id
+
+    try
+    {
+        vector<PlayerEntry> byId(Players, Players + numOfPlayers);
+        radixSort(byId, [](const PlayerEntry& e) { return (uint32_t)e.PlayerID; });
+        for (int i = 0; i < numOfPlayers; i++) {
+            if ((i > 0 && byId[i].PlayerID == byId[i - 1].PlayerID) || playersById->findData(byId[i].PlayerID))
+                return FAILURE;
+        }
+
+        // one lookup per distinct group
+        vector<int> groupIds(numOfPlayers);
+        for (int i = 0; i < numOfPlayers; i++)
+            groupIds[i] = byId[i].GroupID;
+        sort(groupIds.begin(), groupIds.end());
+        groupIds.erase(unique(groupIds.begin(), groupIds.end()), groupIds.end());
+        groups.resize(groupIds.size());
+        for (size_t g = 0; g < groupIds.size(); g++) {
+            groups[g] = groupTree->findData(groupIds[g]);
+            if (groups[g] == NULL)
+                return FAILURE;
+        }
+
+        vector<Player> players;
+        vector<int> groupOf(numOfPlayers); // index in groups of each player, in id order
+        players.reserve(numOfPlayers);
+        for (int i = 0; i < numOfPlayers; i++) {
+            groupOf[i] = (int)(lower_bound(groupIds.begin(), groupIds.end(), byId[i].GroupID) - groupIds.begin());
+            players.emplace_back(byId[i].PlayerID, byId[i].Level, groups[groupOf[i]]->set);
+        }
+
+        // the level trees point at the Player stored inside its node, so those go first
+        vector<Player*> stored;
+        stored.reserve(numOfPlayers);
+        if (newById.buildFromSorted(players.begin(), players.end(),
+            [&stored](AVLNode<Player>* node) { stored.push_back(node->getData()); }) != TreeResult::SUCCESS)
+            throw bad_alloc();
+
+        // a stable sort by level of the descending id order is the (level, id) order of the trees
+        vector<int> levelOrder(numOfPlayers); // indices in id order
+        for (int i = 0; i < numOfPlayers; i++)
+            levelOrder[i] = numOfPlayers - 1 - i;
+        radixSort(levelOrder, [&byId](int i) { return (uint32_t)byId[i].Level; });
+
+        vector<PlayerPointer> byLevel(numOfPlayers);
+        for (int i = 0; i < numOfPlayers; i++)
+            byLevel[i] = PlayerPointer(stored[levelOrder[i]]);
+
+        if (newByLevel.buildFromSorted(byLevel.begin(), byLevel.end(),
+            [](AVLNode<PlayerPointer>* node) { node->getData()->player->player_level = node; }) != TreeResult::SUCCESS)
+            throw bad_alloc();
+
+        // distributing the level order by group keeps every group's run sorted
+        vector<int> groupStart(groups.size() + 1, 0);
+        for (int i = 0; i < numOfPlayers; i++)
+            groupStart[groupOf[i] + 1]++;
+        for (size_t g = 0; g < groups.size(); g++)
+            groupStart[g + 1] += groupStart[g];
+
+        vector<int> next(groupStart.begin(), groupStart.end() - 1);
+        vector<PlayerPointer> byGroup(numOfPlayers);
+        for (int i = 0; i < numOfPlayers; i++)
+            byGroup[next[groupOf[levelOrder[i]]]++] = byLevel[i];
+
+        auto linkGroupPlayer = [](AVLNode<PlayerPointer>* node) { node->getData()->player->group_player = node; };
+        newGroupPlayers.reserve(groups.size());
+        vector<GroupPointer> nowNonEmpty;
+        for (size_t g = 0; g < groups.size(); g++) {
+            newGroupPlayers.push_back(NULL);
+            newGroupPlayers[g] = new LevelTree();
+            if (newGroupPlayers[g]->buildFromSorted(byGroup.begin() + groupStart[g], byGroup.begin() + groupStart[g + 1],
+                linkGroupPlayer) != TreeResult::SUCCESS)
+                throw bad_alloc();
+
+            if (groups[g]->getSize() == 0) {
+                GroupPointer group_ptr = GroupPointer();
+                group_ptr.group = groups[g];
+                nowNonEmpty.push_back(group_ptr);
+            }
+        }
+
+        if (newNonEmpty.buildFromSorted(nowNonEmpty.begin(), nowNonEmpty.end(),
+            [](AVLNode<GroupPointer>* node) { node->getData()->group->groupPointer = node; }) != TreeResult::SUCCESS)
+            throw bad_alloc();
+    }
+    catch (const bad_alloc&) {
+        for (size_t g = 0; g < newGroupPlayers.size(); g++)
+            delete newGroupPlayers[g];
+        return ALLOCATION_ERROR;
+    }
+
+    // merging only relinks nodes, so from here on nothing can fail
+    playersById->merge(newById);
+    playersByLevel->merge(newByLevel);
+    NonEmptyGroups->merge(newNonEmpty);
+    for (size_t g = 0; g < groups.size(); g++) {
+        groups[g]->set->refs += newGroupPlayers[g]->getSize();
+        groups[g]->groupPlayers->merge(*newGroupPlayers[g]);
+        groups[g]->setSize(groups[g]->groupPlayers->getSize());
+        groups[g]->highest_player = groups[g]->groupPlayers->getHighest();
+        delete newGroupPlayers[g];
+        publishHighest(groups[g]);
+    }
+
+    for (int i = 0; leaderboard != NULL && i < numOfPlayers; i++)
+        leaderboardInsert(PlayerPointer::makeKey(Players[i].Level, Players[i].PlayerID));
+
+    // logged as the AddPlayer calls it stands for
+    for (int i = 0; i < numOfPlayers; i++)
+        logOperation(LogOp::ADD_PLAYER, Players[i].PlayerID, Players[i].GroupID, Players[i].Level);
+
+    return SUCCESS;
 }
 
 StatusType PlayersManager::RemovePlayer(int PlayerID)
@@ -230,36 +412,28 @@ StatusType PlayersManager::RemovePlayer(int PlayerID)
     if (player == NULL) return FAILURE;
 
     // delete player from playersByLevel
-    AVLNode<PlayerPointer>* level_swapped;
-    playersByLevel->deleteByPointer(player->player_level, &level_swapped);
-    if (level_swapped) {
-        level_swapped->getData()->player->player_level = level_swapped;
-    }
+    leaderboardErase(player->player_level->getData()->key);
+    playersByLevel->deleteByPointer(player->player_level);
 
     // delete player from groupPlayers
-    Group* playerGroup = player->getGroup();
+    Group* playerGroup = player->getGroup(groupSets);
 
-    AVLNode<PlayerPointer>* group_swapped;
-    playerGroup->groupPlayers->deleteByPointer(player->group_player, &group_swapped);
-    if (group_swapped) {
-        group_swapped->getData()->player->group_player = group_swapped;
-    }
+    playerGroup->groupPlayers->deleteByPointer(player->group_player);
     playerGroup->highest_player = playerGroup->groupPlayers->getHighest();
     playerGroup->setSize(playerGroup->groupPlayers->getSize());
 
     // if player's group has no more players, delete the group from NonEmptyGroups
     if (playerGroup->getSize() == 0) {
-        AVLNode<GroupPointer>* group_swapped;
-        NonEmptyGroups->deleteByPointer(playerGroup->groupPointer, &group_swapped);
-        if (group_swapped) {
-            group_swapped->getData()->group->groupPointer = group_swapped;
-        }
+        NonEmptyGroups->deleteByPointer(playerGroup->groupPointer);
         playerGroup->groupPointer = nullptr;
     }
 
     // delete player from playersById
+    GroupSet::release(player->getGroupSet(), groupSets);
     playersById->deleteNode(PlayerID);
     
+    publishHighest(playerGroup);
+    logOperation(LogOp::REMOVE_PLAYER, PlayerID);
     return SUCCESS;
 }
 
@@ -276,7 +450,10 @@ StatusType PlayersManager::ReplaceGroup(int GroupID, int ReplacementID)
     }
     
     if (group1->getSize() == 0) {
+        GroupSet::release(group1->set, groupSets);
         groupTree->deleteNode(GroupID);
+        unpublishGroup(GroupID);
+        logOperation(LogOp::REPLACE_GROUP, GroupID, ReplacementID);
         return SUCCESS;
     }
     
@@ -285,34 +462,61 @@ StatusType PlayersManager::ReplaceGroup(int GroupID, int ReplacementID)
         GroupPointer group2_ptr = GroupPointer();
         group2_ptr.group = group2;
 
-        TreeResult res = NonEmptyGroups->insertNode(&group2_ptr, &group2->groupPointer);
+        TreeResult res = NonEmptyGroups->insertNode(group2_ptr, &group2->groupPointer);
         if (res == TreeResult::OUT_OF_MEMORY) {
             return ALLOCATION_ERROR;
         }
     }
 
-    AVLTree<PlayerPointer>* mergedTree = mergeTrees(group1->groupPlayers, group2->groupPlayers);
-    PlayerPointer** mergedArr = mergedTree->orderedArray(mergedTree->getSize());
-    for (int i = 0; i < mergedTree->getSize(); ++i) {
-        mergedArr[i]->player->updateGroup(group2);
+    // group1's players now resolve to group2 without being visited. group2 moves its reference
+    // to the union's root, and group1's goes with it
+    GroupSet* set1 = group1->set;
+    GroupSet* set2 = group2->set;
+    group2->set = GroupSet::unite(set1, set2);
+    group2->set->group = group2;
+    group2->set->refs++;
+    GroupSet::release(set1, groupSets);
+    GroupSet::release(set2, groupSets);
+
+    // fold the smaller tree into the larger one, group2 takes over group1's tree if it is the larger
+    if (group1->groupPlayers->getSize() > group2->groupPlayers->getSize()) {
+        LevelTree* larger = group1->groupPlayers;
+        group1->groupPlayers = group2->groupPlayers;
+        group2->groupPlayers = larger;
     }
-    delete[] mergedArr;
-
-    delete group2->groupPlayers;
-    group2->groupPlayers = mergedTree;
-    group2->setSize(mergedTree->getSize());
+    group2->groupPlayers->merge(*group1->groupPlayers);
+    group2->setSize(group2->groupPlayers->getSize());
     group2->highest_player = group2->groupPlayers->getHighest();
     
-    AVLNode<GroupPointer>* group_swapped;
-    NonEmptyGroups->deleteByPointer(group1->groupPointer, &group_swapped);
-    if (group_swapped) {
-        group_swapped->getData()->group->groupPointer = group_swapped;
-    }
+    NonEmptyGroups->deleteByPointer(group1->groupPointer);
     groupTree->deleteNode(GroupID);
 
+    unpublishGroup(GroupID);
+    publishHighest(group2);
+    logOperation(LogOp::REPLACE_GROUP, GroupID, ReplacementID);
     return SUCCESS;
 }
 
+void PlayersManager::removeGroup(Group* group)
+{
+    for (auto it = group->groupPlayers->begin(); it != group->groupPlayers->end(); ++it) {
+        Player* player = it->player;
+        leaderboardErase(it->key);
+        playersByLevel->deleteByPointer(player->player_level);
+        GroupSet::release(player->getGroupSet(), groupSets);
+        playersById->deleteNode(player->getId());
+    }
+    GroupSet::release(group->set, groupSets);
+
+    if (group->groupPointer != nullptr)
+        NonEmptyGroups->deleteByPointer(group->groupPointer);
+    int GroupID = group->getGroupId();
+    groupTree->deleteNode(GroupID);
+
+    unpublishGroup(GroupID);
+    publishHighest(NULL);
+}
+
 StatusType PlayersManager::IncreaseLevel(int PlayerID, int LevelIncrease)
 {
     if (PlayerID <= 0 || LevelIncrease <= 0)
@@ -321,14 +525,136 @@ StatusType PlayersManager::IncreaseLevel(int PlayerID, int LevelIncrease)
     Player* player = playersById->findData(PlayerID);
     if (player == NULL) return FAILURE;
 
-    Group* player_group = player->getGroup();
-    int player_level = player->getLevel();
-    Player updated_player = Player(PlayerID, player_level + LevelIncrease, player_group);
+    increaseLevel(player, LevelIncrease);
+    logOperation(LogOp::INCREASE_LEVEL, PlayerID, LevelIncrease);
+    return SUCCESS;
+}
 
-    RemovePlayer(PlayerID);
-    
-    return addPlayerToGroup(&updated_player, player_group, playersById, playersByLevel, NonEmptyGroups);
+void PlayersManager::increaseLevel(Player* player, int LevelIncrease)
+{
+    // id and group are unchanged, only the level trees' nodes move, and only if they fall out of order
+    uint64_t oldKey = player->player_level->getData()->key;
+    player->increaseLevel(LevelIncrease);
+
+    Group* player_group = player->getGroup(groupSets);
+    player->player_level->getData()->refreshKey();
+    leaderboardErase(oldKey);
+    leaderboardInsert(player->player_level->getData()->key);
+    player->group_player->getData()->refreshKey();
+    playersByLevel->reposition(player->player_level);
+    player_group->groupPlayers->reposition(player->group_player);
+    player_group->highest_player = player_group->groupPlayers->getHighest();
+
+    publishHighest(player_group);
+}
+
+// a run of AddPlayer calls in a batch is first tried as one AddPlayersBulk when it is at least
+// this long. The bulk merges cost O(m log(n/m + 1)) like the m calls, but sorting and building
+// the side trees first makes it about twice as slow on short runs; in bench/BulkRunBench.cpp it
+// breaks even at 2-4 thousand players whether the DS holds 10 thousand or a million
+static const int BULK_RUN_MIN = 4096;
 
+StatusType PlayersManager::ApplyBatch(const BatchOp* ops, int numOfOps, StatusType* results)
+{
+    if (numOfOps < 0 || ((ops == NULL || results == NULL) && numOfOps > 0))
+        return INVALID_INPUT;
+
+    // the last group and player looked up, nodes never move so they stay valid until removed
+    Group* group = NULL;
+    Player* player = NULL;
+    auto findGroup = [this, &group](int GroupID) {
+        if (group == NULL || group->getGroupId() != GroupID)
+            group = groupTree->findData(GroupID);
+        return group;
+    };
+
+    vector<PlayerEntry> run;
+    int next;
+    for (int i = 0; i < numOfOps; i = next) {
+        const BatchOp& op = ops[i];
+        next = i + 1;
+        switch (op.type) {
+        case BATCH_ADD_GROUP:
+            results[i] = AddGroup(op.arg1);
+            break;
+        case BATCH_REMOVE_PLAYER:
+            if (player != NULL && player->getId() == op.arg1)
+                player = NULL;
+            results[i] = RemovePlayer(op.arg1);
+            break;
+        case BATCH_REPLACE_GROUP:
+            if (group != NULL && group->getGroupId() == op.arg1)
+                group = NULL;
+            results[i] = ReplaceGroup(op.arg1, op.arg2);
+            break;
+        case BATCH_ADD_PLAYER:
+        {
+            while (next < numOfOps && ops[next].type == BATCH_ADD_PLAYER)
+                next++;
+
+            // the bulk adds all of them or none, and all of them is what the calls would do
+            if (next - i >= BULK_RUN_MIN) {
+                try
+                {
+                    run.resize(next - i);
+                    for (int j = i; j < next; j++) {
+                        run[j - i].PlayerID = ops[j].arg1;
+                        run[j - i].GroupID = ops[j].arg2;
+                        run[j - i].Level = ops[j].arg3;
+                    }
+                    if (AddPlayersBulk(run.data(), next - i) == SUCCESS) {
+                        for (int j = i; j < next; j++)
+                            results[j] = SUCCESS;
+                        break;
+                    }
+                }
+                catch (const bad_alloc&) {
+                    // the calls one by one need no memory of their own
+                }
+            }
+
+            for (int j = i; j < next; j++) {
+                if (ops[j].arg1 <= 0 || ops[j].arg2 <= 0 || ops[j].arg3 < 0)
+                    results[j] = INVALID_INPUT;
+                else
+                    results[j] = addPlayer(ops[j].arg1, findGroup(ops[j].arg2), ops[j].arg3);
+            }
+            break;
+        }
+        case BATCH_INCREASE_LEVEL:
+        {
+            if (op.arg1 <= 0 || op.arg2 <= 0) {
+                results[i] = INVALID_INPUT;
+                break;
+            }
+            if (player == NULL || player->getId() != op.arg1)
+                player = playersById->findData(op.arg1);
+            if (player == NULL) {
+                results[i] = FAILURE;
+                break;
+            }
+
+            // the increases of the player in a row move it in the trees once
+            int total = op.arg2;
+            while (next < numOfOps && ops[next].type == BATCH_INCREASE_LEVEL
+                && ops[next].arg1 == op.arg1 && ops[next].arg2 > 0) {
+                total += ops[next].arg2;
+                next++;
+            }
+            increaseLevel(player, total);
+            for (int j = i; j < next; j++) {
+                results[j] = SUCCESS;
+                logOperation(LogOp::INCREASE_LEVEL, ops[j].arg1, ops[j].arg2);
+            }
+            break;
+        }
+        default:
+            results[i] = INVALID_INPUT;
+            break;
+        }
+    }
+
+    return SUCCESS;
 }
 
 StatusType PlayersManager::GetHighestLevel(int GroupID, int *PlayerID) {
@@ -355,48 +681,217 @@ StatusType PlayersManager::GetHighestLevel(int GroupID, int *PlayerID) {
     return SUCCESS;
 }
 
-static int* getPlayersByLevel(int numOfPlayers, AVLTree<PlayerPointer>* playersTree)
+void PlayersManager::publishHighest(Group* group)
 {
-    int* players = (int*)malloc(numOfPlayers * sizeof(int));
+    if (!concurrent)
+        return;
 
-    PlayerPointer** player_pointers = playersTree->orderedArray(numOfPlayers);
+    if (group != NULL)
+        published.publish(group->getGroupId(), group->getSize() == 0 ? -1 : group->highest_player->player->getId());
+    published.publishGlobal(playersById->getSize() == 0 ? -1 : playersByLevel->getHighest()->player->getId());
+}
 
-    int i = numOfPlayers - 1;
-    int j = 0;
-    while (i >= 0 && j < numOfPlayers) {
-        players[j] = player_pointers[i]->player->getId();
-        i--;
-        j++;
+StatusType PlayersManager::GetHighestLevelLockFree(int GroupID, int* PlayerID) const
+{
+    if (GroupID == 0 || !PlayerID) {
+        return INVALID_INPUT;
     }
-    delete[] player_pointers;
 
-    return players;
+    int highest = GroupID < 0 ? published.highest() : published.highestOf(GroupID);
+    if (highest == PublishedHighest::NO_GROUP)
+        return FAILURE;
+
+    *PlayerID = highest;
+    return SUCCESS;
 }
 
-StatusType PlayersManager::GetAllPlayersByLevel(int GroupID, int** Players, int* numOfPlayers)
+bool PlayersManager::keepLeaderboard()
 {
-    if (GroupID == 0 || !Players || !numOfPlayers)
-        return INVALID_INPUT;
-    
-    try 
-    {
-        if (GroupID > 0) 
-        {
-            Group* group = groupTree->findData(GroupID);
-            if (group == NULL) return FAILURE;
+    // a view stops counting before it releases its snapshot, so one closed while this runs only
+    // keeps the leaderboard until the next change
+    if (leaderboard != NULL && openViews->load(std::memory_order_acquire) == 0 && !leaderboard->isShared()) {
+        delete leaderboard;
+        leaderboard = NULL;
+    }
+    return leaderboard != NULL;
+}
+
+void PlayersManager::leaderboardInsert(uint64_t key)
+{
+    if (keepLeaderboard() && leaderboard->insertNode(key) == TreeResult::OUT_OF_MEMORY) {
+        delete leaderboard;
+        leaderboard = NULL;
+    }
+}
+
+void PlayersManager::leaderboardErase(uint64_t key)
+{
+    if (keepLeaderboard() && leaderboard->deleteNode(key) == TreeResult::OUT_OF_MEMORY) {
+        delete leaderboard;
+        leaderboard = NULL;
+    }
+}
 
-            *numOfPlayers = group->groupPlayers->getSize();
-            *Players = getPlayersByLevel(*numOfPlayers, group->groupPlayers);
+LeaderboardView* PlayersManager::OpenLeaderboardView()
+{
+    if (!openViews) {
+        try
+        {
+            openViews = make_shared<atomic<int> >(0);
+        }
+        catch (const bad_alloc&) {
+            return NULL;
         }
+    }
 
-        else if (GroupID < 0) 
+    if (leaderboard == NULL) {
+        // built from playersByLevel's keys, which come already sorted
+        leaderboard = new (std::nothrow) LeaderboardTree();
+        if (leaderboard == NULL)
+            return NULL;
+        try
         {
-            *numOfPlayers = playersByLevel->getSize();
-            *Players = getPlayersByLevel(*numOfPlayers, playersByLevel);
+            vector<uint64_t> keys;
+            keys.reserve(playersByLevel->getSize());
+            for (auto it = playersByLevel->begin(); it != playersByLevel->end(); ++it)
+                keys.push_back(it->key);
+            if (leaderboard->buildFromSorted(keys.begin(), keys.end()) != TreeResult::SUCCESS)
+                throw bad_alloc();
+        }
+        catch (const bad_alloc&) {
+            delete leaderboard;
+            leaderboard = NULL;
+            return NULL;
         }
     }
-    catch (bad_alloc&) {
+
+    return new (std::nothrow) LeaderboardView(leaderboard->snapshot(), openViews);
+}
+
+LevelTree* PlayersManager::levelTreeOf(int GroupID)
+{
+    if (GroupID < 0)
+        return playersByLevel;
+
+    Group* group = groupTree->findData(GroupID);
+    return group == NULL ? NULL : group->groupPlayers;
+}
+
+// writes up to capacity player ids, highest level first, straight from a reverse walk of the tree from it
+static int copyPlayersByLevel(LevelTree::ReverseIterator it, int* players, int capacity)
+{
+    int j = 0;
+    for (; it != LevelTree::ReverseIterator() && j < capacity; ++it) {
+        players[j++] = it->player->getId();
+    }
+
+    return j;
+}
+
+StatusType PlayersManager::GetAllPlayersByLevel(int GroupID, int** Players, int* numOfPlayers)
+{
+    if (GroupID == 0 || !Players || !numOfPlayers)
+        return INVALID_INPUT;
+
+    LevelTree* playersTree = levelTreeOf(GroupID);
+    if (playersTree == NULL)
+        return FAILURE;
+
+    int count = playersTree->getSize();
+    int* players = (int*)malloc(count * sizeof(int));
+    if (players == NULL && count > 0)
         return ALLOCATION_ERROR;
+
+    *numOfPlayers = copyPlayersByLevel(playersTree->rbegin(), players, count);
+    *Players = players;
+    return SUCCESS;
+}
+
+StatusType PlayersManager::GetAllPlayersByLevelInto(int GroupID, int* Players, int capacity, int* numOfPlayers)
+{
+    if (GroupID == 0 || capacity < 0 || (!Players && capacity > 0) || !numOfPlayers)
+        return INVALID_INPUT;
+
+    LevelTree* playersTree = levelTreeOf(GroupID);
+    if (playersTree == NULL)
+        return FAILURE;
+
+    // the full count is reported either way, so a caller can retry with a large enough buffer
+    *numOfPlayers = playersTree->getSize();
+    copyPlayersByLevel(playersTree->rbegin(), Players, capacity);
+    return *numOfPlayers <= capacity ? SUCCESS : FAILURE;
+}
+
+StatusType PlayersManager::GetTopPlayersByLevel(int GroupID, int k, int offset, int* Players, int* numOfPlayers)
+{
+    if (GroupID == 0 || k < 0 || offset < 0 || (!Players && k > 0) || !numOfPlayers)
+        return INVALID_INPUT;
+
+    LevelTree* playersTree = levelTreeOf(GroupID);
+    if (playersTree == NULL)
+        return FAILURE;
+
+    if (offset >= playersTree->getSize()) {
+        *numOfPlayers = 0;
+        return SUCCESS;
+    }
+
+    // the walk starts at the page's first player, found through the subtree sizes, and reads only the page
+    *numOfPlayers = copyPlayersByLevel(playersTree->reverseIteratorAt(offset + 1), Players, k);
+    return SUCCESS;
+}
+
+// number of players in playersTree whose level is at most level, through the subtree sizes
+static int countUpToLevel(LevelTree* playersTree, int level)
+{
+    // id 0 is never a player's, and its key is the highest one the level can have
+    return level < 0 ? 0 : playersTree->rank(PlayerPointer::makeKey(level, 0));
+}
+
+StatusType PlayersManager::CountPlayersInLevelRange(int GroupID, int lowLevel, int highLevel, int* numOfPlayers)
+{
+    if (GroupID == 0 || lowLevel > highLevel || !numOfPlayers)
+        return INVALID_INPUT;
+
+    LevelTree* playersTree = levelTreeOf(GroupID);
+    if (playersTree == NULL)
+        return FAILURE;
+
+    *numOfPlayers = countUpToLevel(playersTree, highLevel)
+        - (lowLevel <= 0 ? 0 : countUpToLevel(playersTree, lowLevel - 1));
+    return SUCCESS;
+}
+
+StatusType PlayersManager::GetPlayerRank(int PlayerID, int GroupID, int* Rank)
+{
+    if (PlayerID <= 0 || GroupID == 0 || !Rank)
+        return INVALID_INPUT;
+
+    Player* player = playersById->findData(PlayerID);
+    if (player == NULL)
+        return FAILURE;
+    Group* group = player->getGroupReadOnly();
+    if (GroupID > 0 && group->getGroupId() != GroupID)
+        return FAILURE;
+
+    // 1 for the first player of GetAllPlayersByLevel's order
+    LevelTree* playersTree = GroupID < 0 ? playersByLevel : group->groupPlayers;
+    *Rank = playersTree->getSize() - playersTree->rank(player->player_level->getData()->key) + 1;
+    return SUCCESS;
+}
+
+StatusType PlayersManager::ForEachPlayerByLevel(int GroupID, PlayerVisitor visit, void* context)
+{
+    if (GroupID == 0 || !visit)
+        return INVALID_INPUT;
+
+    LevelTree* playersTree = levelTreeOf(GroupID);
+    if (playersTree == NULL)
+        return FAILURE;
+
+    for (auto it = playersTree->rbegin(); it != playersTree->rend(); ++it) {
+        if (visit(it->player->getId(), context) != 0)
+            break;
     }
 
     return SUCCESS;
@@ -412,14 +907,14 @@ StatusType PlayersManager::GetGroupsHighestLevel(int numOfGroups, int **Players)
     }
     try 
     {
-        GroupPointer** arr = NonEmptyGroups->orderedArray(numOfGroups);
-    
         int* highestPlayers = (int*)malloc(numOfGroups * sizeof(int));
+        if (highestPlayers == NULL)
+            throw bad_alloc();
 
-        for (int i = 0; i < numOfGroups; i++) {
-            highestPlayers[i] = arr[i]->group->highest_player->player->getId();
+        auto it = NonEmptyGroups->begin();
+        for (int i = 0; i < numOfGroups; i++, ++it) {
+            highestPlayers[i] = it->group->highest_player->player->getId();
         }
-        delete[] arr;
         
         *Players = highestPlayers;
     }
@@ -429,3 +924,312 @@ StatusType PlayersManager::GetGroupsHighestLevel(int numOfGroups, int **Players)
     
     return SUCCESS;
 }
+
+StatusType PlayersManager::SaveSnapshot(const char* path)
+{
+    if (path == NULL)
+        return INVALID_INPUT;
+
+    vector<int32_t> groupIds;
+    vector<PlayerEntry> players;
+    try
+    {
+        groupIds.reserve(groupTree->getSize());
+        for (auto it = groupTree->begin(); it != groupTree->end(); ++it)
+            groupIds.push_back(it->getGroupId());
+
+        players.reserve(playersById->getSize());
+        for (auto it = playersById->begin(); it != playersById->end(); ++it) {
+            PlayerEntry entry;
+            entry.PlayerID = it->getId();
+            entry.GroupID = it->getGroupReadOnly()->getGroupId();
+            entry.Level = it->getLevel();
+            players.push_back(entry);
+        }
+    }
+    catch (const bad_alloc&) {
+        return ALLOCATION_ERROR;
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.numOfGroups = (int32_t)groupIds.size();
+    header.numOfPlayers = (int32_t)players.size();
+    header.sequence = sequence;
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+        return FAILURE;
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && writeArray(file, groupIds) && writeArray(file, players) && flushToDisk(file);
+    if (fclose(file) != 0)
+        written = false;
+
+    return written ? SUCCESS : FAILURE;
+}
+
+StatusType PlayersManager::LoadSnapshot(const char* path)
+{
+    if (path == NULL)
+        return INVALID_INPUT;
+    // the history is replaced, so it cannot continue a log
+    if (groupTree->getSize() != 0 || log.IsOpen())
+        return FAILURE;
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return FAILURE;
+
+    SnapshotHeader header;
+    vector<int32_t> groupIds;
+    vector<PlayerEntry> players;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1
+        && memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) == 0
+        && header.version == SNAPSHOT_VERSION
+        && header.numOfGroups >= 0 && header.numOfPlayers >= 0
+        // the counts must describe the rest of the file exactly, before anything is allocated for them
+        && remainingBytes(file) == (int64_t)header.numOfGroups * (int64_t)sizeof(int32_t)
+            + (int64_t)header.numOfPlayers * (int64_t)sizeof(PlayerEntry);
+    try
+    {
+        valid = valid && readArray(file, groupIds, header.numOfGroups)
+            && readArray(file, players, header.numOfPlayers);
+    }
+    catch (const bad_alloc&) {
+        fclose(file);
+        return ALLOCATION_ERROR;
+    }
+    fclose(file);
+
+    for (size_t i = 0; valid && i < groupIds.size(); i++)
+        valid = groupIds[i] > 0 && (i == 0 || groupIds[i] > groupIds[i - 1]);
+    if (!valid)
+        return FAILURE;
+    if (concurrent && !published.reserve((int)groupIds.size()))
+        return ALLOCATION_ERROR;
+
+    // the groups come sorted, so their tree is built directly; group nodes never move, so each
+    // set can point at the Group inside its node
+    auto linkSet = [this](AVLNode<Group>* node) {
+        GroupSet* set = new (groupSets.allocate()) GroupSet(node->getData());
+        node->getData()->set = set;
+    };
+    if (groupTree->buildFromSorted(groupIds.begin(), groupIds.end(), linkSet) != TreeResult::SUCCESS) {
+        groupSets.release();
+        return ALLOCATION_ERROR;
+    }
+
+    StatusType result = AddPlayersBulk(players.data(), (int)players.size());
+    if (result != SUCCESS) {
+        delete groupTree;
+        groupTree = new GroupTree();
+        groupSets.release();
+        return result == ALLOCATION_ERROR ? ALLOCATION_ERROR : FAILURE;
+    }
+
+    for (auto it = groupTree->begin(); it != groupTree->end(); ++it)
+        publishHighest(&*it);
+
+    sequence = header.sequence;
+    return SUCCESS;
+}
+
+StatusType PlayersManager::SaveFrozenSnapshot(const char* path)
+{
+    if (path == NULL)
+        return INVALID_INPUT;
+
+    // every section is laid out in the order its query answers in
+    vector<int32_t> byLevel;
+    vector<FrozenGroup> groups;
+    vector<int32_t> groupPlayers;
+    vector<int32_t> groupsHighest;
+    try
+    {
+        byLevel.reserve(playersByLevel->getSize());
+        for (auto it = playersByLevel->rbegin(); it != playersByLevel->rend(); ++it)
+            byLevel.push_back(it->player->getId());
+
+        groups.reserve(groupTree->getSize());
+        groupPlayers.reserve(playersById->getSize());
+        for (auto it = groupTree->begin(); it != groupTree->end(); ++it) {
+            FrozenGroup group;
+            group.id = it->getGroupId();
+            group.start = (int32_t)groupPlayers.size();
+            group.size = it->groupPlayers->getSize();
+            groups.push_back(group);
+
+            for (auto player = it->groupPlayers->rbegin(); player != it->groupPlayers->rend(); ++player)
+                groupPlayers.push_back(player->player->getId());
+            if (group.size > 0)
+                groupsHighest.push_back(it->highest_player->player->getId());
+        }
+    }
+    catch (const bad_alloc&) {
+        return ALLOCATION_ERROR;
+    }
+
+    FrozenHeader header;
+    memcpy(header.magic, FROZEN_MAGIC, sizeof(header.magic));
+    header.version = FROZEN_VERSION;
+    header.numOfGroups = (int32_t)groups.size();
+    header.numOfPlayers = (int32_t)byLevel.size();
+    header.numOfNonEmpty = (int32_t)groupsHighest.size();
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+        return FAILURE;
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && writeArray(file, byLevel) && writeArray(file, groups)
+        && writeArray(file, groupPlayers) && writeArray(file, groupsHighest);
+    if (fclose(file) != 0)
+        written = false;
+
+    return written ? SUCCESS : FAILURE;
+}
+
+StatusType PlayersManager::OpenLog(const char* path, int batchSize)
+{
+    if (path == NULL || batchSize < 1)
+        return INVALID_INPUT;
+
+    return log.Open(path, sequence, batchSize);
+}
+
+StatusType PlayersManager::SyncLog()
+{
+    return log.Commit();
+}
+
+StatusType PlayersManager::Checkpoint(const char* snapshotPath)
+{
+    if (snapshotPath == NULL)
+        return INVALID_INPUT;
+
+    // the snapshot replaces the old one in one step, so a crash leaves one of them whole
+    StatusType result = log.Commit();
+    string temp = string(snapshotPath) + ".tmp";
+    if (result == SUCCESS)
+        result = SaveSnapshot(temp.c_str());
+    if (result == SUCCESS && !replaceFile(temp.c_str(), snapshotPath))
+        result = FAILURE;
+    if (result != SUCCESS || !log.IsOpen())
+        return result;
+
+    // a crash before this point leaves the old log, whose records the snapshot already holds
+    string logPath = log.GetPath();
+    return log.Create(logPath.c_str(), sequence, log.GetBatchSize());
+}
+
+static const int REPLAY_CHUNK = 1 << 16;
+
+// applies the records after the manager's sequence, consecutive AddPlayer records together
+StatusType PlayersManager::replayLog(const char* logPath, uint64_t* logEnd)
+{
+    OperationLog::Reader reader;
+    if (reader.Open(logPath) != SUCCESS)
+        return FAILURE;
+
+    uint64_t position = reader.GetBaseSequence();
+    uint64_t replayFrom = sequence; // the records before it are already in the manager
+    if (position > replayFrom)
+        return FAILURE; // mutations between the snapshot and the log are missing
+
+    vector<LogRecord> records;
+    vector<PlayerEntry> added;
+    StatusType result = SUCCESS;
+    try {
+        records.resize(REPLAY_CHUNK);
+        added.reserve(REPLAY_CHUNK);
+
+        int count;
+        while (result == SUCCESS && (count = reader.Read(records.data(), REPLAY_CHUNK)) > 0) {
+            for (int i = 0; i < count && result == SUCCESS; i++, position++) {
+                if (position < replayFrom)
+                    continue;
+
+                const LogRecord& record = records[i];
+                if (record.op == (uint32_t)LogOp::ADD_PLAYER) {
+                    PlayerEntry entry;
+                    entry.PlayerID = record.args[0];
+                    entry.GroupID = record.args[1];
+                    entry.Level = record.args[2];
+                    added.push_back(entry);
+                    if (added.size() < (size_t)REPLAY_CHUNK)
+                        continue;
+                }
+
+                if (!added.empty()) {
+                    result = AddPlayersBulk(added.data(), (int)added.size());
+                    added.clear();
+                }
+                if (result != SUCCESS || record.op == (uint32_t)LogOp::ADD_PLAYER)
+                    continue;
+
+                switch ((LogOp)record.op) {
+                case LogOp::ADD_GROUP:
+                    result = AddGroup(record.args[0]);
+                    break;
+                case LogOp::REMOVE_PLAYER:
+                    result = RemovePlayer(record.args[0]);
+                    break;
+                case LogOp::REPLACE_GROUP:
+                    result = ReplaceGroup(record.args[0], record.args[1]);
+                    break;
+                case LogOp::INCREASE_LEVEL:
+                    result = IncreaseLevel(record.args[0], record.args[1]);
+                    break;
+                default:
+                    result = FAILURE;
+                    break;
+                }
+            }
+        }
+
+        if (result == SUCCESS && !added.empty())
+            result = AddPlayersBulk(added.data(), (int)added.size());
+    }
+    catch (const bad_alloc&) {
+        return ALLOCATION_ERROR;
+    }
+
+    // every logged call succeeded once, so one that fails now means the files do not match
+    if (result != SUCCESS)
+        return result == ALLOCATION_ERROR ? ALLOCATION_ERROR : FAILURE;
+
+    *logEnd = position;
+    return SUCCESS;
+}
+
+StatusType PlayersManager::Recover(const char* snapshotPath, const char* logPath, int batchSize)
+{
+    if (logPath == NULL || batchSize < 1)
+        return INVALID_INPUT;
+    if (groupTree->getSize() != 0 || log.IsOpen())
+        return FAILURE;
+
+    if (snapshotPath != NULL) {
+        StatusType result = LoadSnapshot(snapshotPath);
+        if (result != SUCCESS)
+            return result;
+    }
+
+    FILE* existing = fopen(logPath, "rb");
+    if (existing == NULL)
+        return log.Create(logPath, sequence, batchSize);
+    fclose(existing);
+
+    uint64_t logEnd;
+    StatusType result = replayLog(logPath, &logEnd);
+    if (result != SUCCESS)
+        return result;
+
+    // the snapshot may hold every record of the log, which then starts over after it
+    if (logEnd < sequence)
+        return log.Create(logPath, sequence, batchSize);
+    return log.Open(logPath, sequence, batchSize);
+}
@@ -3,16 +3,46 @@
 
 #include "library1.h"
 #include "AVLTree.h"
+#include "OperationLog.h"
+#include "PublishedHighest.h"
+#include "PersistentAVLTree.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 
 class PlayerPointer;
 class Group;
 class GroupPointer;
 
+// union-find element for a group players joined. Merged groups share one root, which points at
+// the group that now holds them, so merging never has to visit the players.
+// A set counts the players, child sets and group pointing at it, and goes back to the pool once
+// none is left, so the sets never outnumber the live players and groups.
+class GroupSet
+{
+public:
+	GroupSet* parent; // nullptr on the root
+	Group* group; // only meaningful on the root
+	int rank;
+	int refs;
+
+	GroupSet(Group* group) : parent(nullptr), group(group), rank(0), refs(1) {} // the group's
+
+	GroupSet* find(NodePool<GroupSet>& pool); // with path compression, frees the sets it unlinks
+	GroupSet* findRoot(); // without, it only reads so it is safe under a shared lock
+	// links the two roots, returns the root of the union
+	static GroupSet* unite(GroupSet* root1, GroupSet* root2);
+	// drops one reference to set, and frees it and then its parents while nothing refers to them
+	static void release(GroupSet* set, NodePool<GroupSet>& pool);
+};
+
 class Player
 {
 	int id;
 	int level;
-	Group* group;
+	GroupSet* groupSet; // set of the group the player joined, resolved through find()
 
 	friend class PlayerPointer;
 
@@ -21,83 +51,80 @@ public:
 	AVLNode<PlayerPointer>* group_player; // pointer to Player's node in its group's groupPlayers tree
 
 	Player() = default;
-	Player(int playerId, int level, Group* group) :
-		id(playerId), level(level), group(group) {
+	Player(int playerId, int level, GroupSet* groupSet) :
+		id(playerId), level(level), groupSet(groupSet) {
 		player_level = nullptr;
 		group_player = nullptr;
 	}
-	~Player() {}
-
-	Player& operator=(const Player& p) {
-		this->id = p.getId();
-		this->level = p.getLevel();
-		this->group = p.getGroup();
-		this->player_level = p.player_level;
-		this->group_player = p.group_player;
-		return *this;
-	}
-
-	bool operator<(int id) const{ return this->id < id; }
-	bool operator<(const Player& p) const{ return this->id < p.id; }
-	bool operator>(int id) const{ return this->id > id; }
-	bool operator>(const Player& p) const{ return this->id > p.id; }
-	bool operator==(int id) const{ return this->id == id; }
-	bool operator==(const Player& p) const{ return this->id == p.id; }
 
 	int getId() const{ return id; }
 	int getLevel() const{ return level; }
-	Group* getGroup() const { return group; }
-	void updateGroup(Group* g) { group = g; }
+	// the level trees must be repositioned after this
+	void increaseLevel(int levelIncrease) { level += levelIncrease; }
+	Group* getGroup(NodePool<GroupSet>& pool) const { return groupSet->find(pool)->group; }
+	// for queries, which must not write to the sets, see PlayersManager::lockShared
+	Group* getGroupReadOnly() const { return groupSet->findRoot()->group; }
+	GroupSet* getGroupSet() const { return groupSet; }
+};
+
+// key policies of the trees, see AVLTree
+struct PlayerIdKey
+{
+	typedef int Key;
+	static int key(const Player& p) { return p.getId(); }
 };
 
 class PlayerPointer{
 public:
     Player* player; // pointer to Player data in playerTree
-	~PlayerPointer() {}
+    uint64_t key; // level in the high half, inverted id in the low half, so ordering never reads player
 
-	PlayerPointer& operator=(const PlayerPointer& pp) {
-		this->player = pp.player;
-		return *this;
-	}
-	
-	bool operator<(int level) const { return player->level < level; }
-	bool operator>(int level) const { return player->level > level; }
-	bool operator==(int id) const { return player->id == id; }
+	PlayerPointer() = default;
+	explicit PlayerPointer(Player* p) : player(p) { refreshKey(); }
 
-	bool operator==(const PlayerPointer& pp) const{
-	    return player->id == pp.player->id;
-	}
-	bool operator<(const PlayerPointer& pp) const{
-		if (player->level == pp.player->level)
-			return player->id > pp.player->id;
-		return player->level < pp.player->level;
-	}
-	bool operator>(const PlayerPointer& pp) const{
-		if (player->level == pp.player->level)
-			return player->id < pp.player->id;
-		return player->level > pp.player->level;
+	// must be called after the player's level changes
+	void refreshKey() { key = makeKey(player->level, player->id); }
+
+	static uint64_t makeKey(int level, int id) {
+		return ((uint64_t)(uint32_t)level << 32) | (uint32_t)(UINT32_MAX - (uint32_t)id);
 	}
+	static int idOfKey(uint64_t key) { return (int)(UINT32_MAX - (uint32_t)key); }
+};
+
+// higher level first, lower id first among equal levels, both in one integer compare
+struct PlayerLevelKey
+{
+	typedef uint64_t Key;
+	static uint64_t key(const PlayerPointer& pp) { return pp.key; }
 };
 
+typedef AVLTree<Player, PlayerIdKey> PlayerTree;
+typedef AVLTree<PlayerPointer, PlayerLevelKey> LevelTree;
+
 class Group
 {
 	int id;
 	int size;
 
-	friend class GroupPointer;
-
 public:
     PlayerPointer* highest_player;
-    AVLTree<PlayerPointer>* groupPlayers; //sorted by level first, id second
+    LevelTree* groupPlayers; //sorted by level first, id second
 	AVLNode<GroupPointer>* groupPointer;
+	GroupSet* set; // root of the union-find set of the players in this group
 
 	Group() = default;
 	Group(int id) : id(id)
 	{
 		size = 0;
 		highest_player = nullptr;
-		groupPlayers = new AVLTree<PlayerPointer>();
+		groupPlayers = new LevelTree();
 		groupPointer = nullptr;
+		set = nullptr;
+	}
+	Group(Group&& g) : id(g.id), size(g.size), highest_player(g.highest_player),
+		groupPlayers(g.groupPlayers), groupPointer(g.groupPointer), set(g.set)
+	{
+		g.groupPlayers = nullptr;
 	}
 	~Group() { 
 		if (this->groupPlayers)
@@ -107,13 +134,6 @@ public:
 
 	Group& operator=(const Group& g);
 
-	bool operator<(int id) const{ return this->id < id; }
-	bool operator<(const Group& g) const{ return this->id < g.id; }
-	bool operator>(int id) const{ return this->id > id; }
-	bool operator>(const Group& g) const{ return this->id > g.id; }
-	bool operator==(int id) const{ return this->id == id; }
-	bool operator==(const Group& g) const{ return this->id == g.id; }
-
 	int getGroupId() const{ return id; }
 	int getSize() const{ return size; }
 	void increaseSize(){ size++; }
@@ -124,41 +144,138 @@ class GroupPointer
 {
 public:
 	Group* group;
-	~GroupPointer() {}
-	GroupPointer& operator=(const GroupPointer& gp) {
-		this->group = gp.group;
-		return *this;
-	}
+};
+
+struct GroupIdKey
+{
+	typedef int Key;
+	static int key(const Group& g) { return g.getGroupId(); }
+};
+
+struct GroupPointerKey
+{
+	typedef int Key;
+	static int key(const GroupPointer& gp) { return gp.group->getGroupId(); }
+};
+
+typedef AVLTree<Group, GroupIdKey> GroupTree;
+typedef AVLTree<GroupPointer, GroupPointerKey> GroupPointerTree;
+// the PlayerPointer keys of every player, see OpenLeaderboardView
+typedef PersistentAVLTree<uint64_t> LeaderboardTree;
 
-	bool operator<(int id) const{ return group->id < id; }
-	bool operator<(const GroupPointer& gp) const{ return group->id < gp.group->id; }
-	bool operator>(int id) const{ return group->id > id; }
-	bool operator>(const GroupPointer& gp) const{ return group->id > gp.group->id; }
-	bool operator==(int id) const{ return group->id == id; }
-	bool operator==(const GroupPointer& gp) const{ return group->id == gp.group->id; }
+// a snapshot of the leaderboard handed out by OpenLeaderboardView. It counts itself in openViews,
+// which it shares with the manager since it may be closed after the manager is gone
+class LeaderboardView : public LeaderboardTree::Snapshot
+{
+	std::shared_ptr<std::atomic<int> > openViews;
+public:
+	LeaderboardView(const LeaderboardTree::Snapshot& snapshot, const std::shared_ptr<std::atomic<int> >& openViews)
+		: LeaderboardTree::Snapshot(snapshot), openViews(openViews) {
+		openViews->fetch_add(1, std::memory_order_relaxed);
+	}
+	~LeaderboardView() { openViews->fetch_sub(1, std::memory_order_release); }
 };
 
+// what the library1 entry points receive as DS, it tells the kinds of manager apart
+class DataStructure
+{
+public:
+	const bool sharded;
+
+	explicit DataStructure(bool sharded) : sharded(sharded) {}
+};
 
-class PlayersManager
+class PlayersManager : public DataStructure
 {
-	AVLTree<Group>* groupTree;
-	AVLTree<GroupPointer>* NonEmptyGroups;
-	AVLTree<Player>* playersById; //sorted by id
-	AVLTree<PlayerPointer>* playersByLevel; //sorted by level first, id second
+	GroupTree* groupTree;
+	GroupPointerTree* NonEmptyGroups;
+	PlayerTree* playersById; //sorted by id
+	LevelTree* playersByLevel; //sorted by level first, id second
+	NodePool<GroupSet> groupSets; //the sets some player, group or other set still refers to
+	OperationLog log; // write-ahead log of the successful mutations, if one is open
+	uint64_t sequence; // number of successful mutations in the manager's history
+	bool concurrent; // calls may come from several threads, see lockShared
+	std::shared_mutex rwLock;
+	PublishedHighest published; // GetHighestLevel's answers, kept only when concurrent
+	LeaderboardTree* leaderboard; // follows playersByLevel while views are open, NULL otherwise
+	std::shared_ptr<std::atomic<int> > openViews; // number of LeaderboardViews not closed yet
+
+	void logOperation(LogOp op, int arg1, int arg2 = 0, int arg3 = 0) {
+		sequence++;
+		log.Append(op, arg1, arg2, arg3);
+	}
+	StatusType replayLog(const char* logPath, uint64_t* logEnd);
+	// the level tree GroupID names, every player's if it is negative; NULL if there is no such group
+	LevelTree* levelTreeOf(int GroupID);
+	// takes the group and its players out without logging it, to move them to another shard
+	void removeGroup(Group* group);
+	// called by every mutation once it succeeded, with the group it changed if any
+	void publishHighest(Group* group);
+	void unpublishGroup(int GroupID) {
+		if (concurrent)
+			published.remove(GroupID);
+	}
+
+	// AddPlayer past the group's lookup, group is NULL if there is no such group
+	StatusType addPlayer(int PlayerID, Group* group, int Level);
+	// IncreaseLevel past the player's lookup, without logging it
+	void increaseLevel(Player* player, int LevelIncrease);
+
+	// called with the key of every player added to or removed from playersByLevel. The leaderboard
+	// is dropped once no view refers to it any more, or if it runs out of memory; the next view
+	// builds it again
+	bool keepLeaderboard();
+	void leaderboardInsert(uint64_t key);
+	void leaderboardErase(uint64_t key);
+
+	friend class ShardedPlayersManager;
 
 public:
 
-	PlayersManager();
+	PlayersManager(bool concurrent = false);
 	~PlayersManager();
 
+	// held by the library1 entry points for the whole call: shared by the queries, exclusive for
+	// everything else. Both return an empty lock unless the manager is concurrent.
+	std::shared_lock<std::shared_mutex> lockShared();
+	std::unique_lock<std::shared_mutex> lockExclusive();
+	bool isConcurrent() const { return concurrent; }
+
 	StatusType AddGroup(int GroupID);
 	StatusType AddPlayer(int PlayerID, int GroupID, int Level);
+	StatusType AddPlayersBulk(const PlayerEntry* Players, int numOfPlayers);
 	StatusType RemovePlayer(int PlayerID);
 	StatusType ReplaceGroup(int GroupID, int ReplacementID);
 	StatusType IncreaseLevel(int PlayerID, int LevelIncrease);
+	StatusType ApplyBatch(const BatchOp* ops, int numOfOps, StatusType* results);
 	StatusType GetHighestLevel(int GroupID, int* PlayerID);
+	// concurrent managers only: same answer, read from the published values without any lock
+	StatusType GetHighestLevelLockFree(int GroupID, int* PlayerID) const;
 	StatusType GetAllPlayersByLevel(int GroupID, int** Players, int* numOfPlayers);
+	StatusType GetAllPlayersByLevelInto(int GroupID, int* Players, int capacity, int* numOfPlayers);
+	StatusType ForEachPlayerByLevel(int GroupID, PlayerVisitor visit, void* context);
+	StatusType GetTopPlayersByLevel(int GroupID, int k, int offset, int* Players, int* numOfPlayers);
+	StatusType CountPlayersInLevelRange(int GroupID, int lowLevel, int highLevel, int* numOfPlayers);
+	StatusType GetPlayerRank(int PlayerID, int GroupID, int* Rank);
 	StatusType GetGroupsHighestLevel(int numOfGroups, int** Players);
+	// O(1) frozen view of every player by level, NULL if out of memory. Unless views are already
+	// open the leaderboard is built in O(n), after which every change to the players by level also
+	// costs O(log n) in it until the views are closed.
+	// Needs the exclusive lock, the view is then read and deleted without any.
+	LeaderboardView* OpenLeaderboardView();
+
+	StatusType SaveSnapshot(const char* path);
+	StatusType LoadSnapshot(const char* path);
+	// for read-only replicas, see FrozenSnapshot
+	StatusType SaveFrozenSnapshot(const char* path);
+
+	// durability, see OperationLog. Every successful mutation is appended to the open log.
+	StatusType OpenLog(const char* path, int batchSize);
+	StatusType SyncLog();
+	// saves a snapshot in place of snapshotPath and starts the log over after it
+	StatusType Checkpoint(const char* snapshotPath);
+	// loads the snapshot (if snapshotPath is not NULL), replays the log after it, and opens the log
+	StatusType Recover(const char* snapshotPath, const char* logPath, int batchSize);
 };
 
 #endif // PLAYERS_MANAGER
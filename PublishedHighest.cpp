@@ -0,0 +1,183 @@
+#include "PublishedHighest.h"
+#include <new>
+#include <thread>
+
+
+/* ------------------------------------------ Helper Functions ------------------------------------------ */
+
+static int hashOf(int GroupID, int capacity)
+{
+    uint32_t hash = (uint32_t)GroupID * 2654435761u;
+    return (int)((hash ^ (hash >> 16)) & (uint32_t)(capacity - 1));
+}
+
+
+/* ------------------------------------------ PublishedHighest Functions ------------------------------------------ */
+
+
+PublishedHighest::PublishedHighest() : table(NULL), used(0), live(0), global(-1), epoch(0)
+{
+    readers[0].store(0);
+    readers[1].store(0);
+}
+
+PublishedHighest::~PublishedHighest()
+{
+    destroyTable(table.load());
+}
+
+PublishedHighest::Table* PublishedHighest::createTable(int capacity)
+{
+    Table* created = new (std::nothrow) Table;
+    if (created == NULL)
+        return NULL;
+
+    created->capacity = capacity;
+    created->keys = new (std::nothrow) std::atomic<int>[capacity]();
+    created->values = new (std::nothrow) std::atomic<int>[capacity]();
+    if (created->keys == NULL || created->values == NULL) {
+        destroyTable(created);
+        return NULL;
+    }
+    return created;
+}
+
+void PublishedHighest::destroyTable(Table* old)
+{
+    if (old == NULL)
+        return;
+    delete[] old->keys;
+    delete[] old->values;
+    delete old;
+}
+
+int PublishedHighest::slotOf(const Table* t, int GroupID)
+{
+    int slot = hashOf(GroupID, t->capacity);
+    while (true) {
+        int key = t->keys[slot].load(std::memory_order_relaxed);
+        if (key == GroupID || key == 0)
+            return slot;
+        slot = (slot + 1) & (t->capacity - 1);
+    }
+}
+
+uint64_t PublishedHighest::enter() const
+{
+    // registered only if the epoch did not move in between, so synchronize() cannot miss us
+    while (true) {
+        uint64_t current = epoch.load();
+        readers[current & 1].fetch_add(1);
+        if (epoch.load() == current)
+            return current;
+        readers[current & 1].fetch_sub(1);
+    }
+}
+
+void PublishedHighest::leave(uint64_t entered) const
+{
+    readers[entered & 1].fetch_sub(1, std::memory_order_release);
+}
+
+void PublishedHighest::synchronize()
+{
+    // new readers go to the other parity; the previous call already drained that one's old readers
+    uint64_t old = epoch.load();
+    epoch.store(old + 1);
+    while (readers[old & 1].load() != 0)
+        std::this_thread::yield();
+}
+
+bool PublishedHighest::reserve(int numOfGroups)
+{
+    Table* current = table.load(std::memory_order_relaxed);
+    if (current != NULL && ((long long)used + numOfGroups) * 2 <= current->capacity)
+        return true;
+
+    // at most half full, which keeps the probes short and always ends them at a free slot.
+    // removed groups are left behind.
+    long long capacity = 16;
+    while (capacity < ((long long)live + numOfGroups) * 2)
+        capacity *= 2;
+    if (capacity > (1LL << 30))
+        return false;
+
+    Table* grown = createTable((int)capacity);
+    if (grown == NULL)
+        return false;
+
+    for (int i = 0; current != NULL && i < current->capacity; i++) {
+        int key = current->keys[i].load(std::memory_order_relaxed);
+        int value = current->values[i].load(std::memory_order_relaxed);
+        if (key == 0 || value == NO_GROUP)
+            continue;
+
+        int slot = slotOf(grown, key);
+        grown->values[slot].store(value, std::memory_order_relaxed);
+        grown->keys[slot].store(key, std::memory_order_relaxed);
+    }
+    used = live;
+
+    table.store(grown);
+    synchronize();
+    destroyTable(current);
+    return true;
+}
+
+void PublishedHighest::publish(int GroupID, int PlayerID)
+{
+    Table* current = table.load(std::memory_order_relaxed);
+    int slot = slotOf(current, GroupID);
+
+    // the value goes first, a reader that finds the key finds its value with it
+    if (current->keys[slot].load(std::memory_order_relaxed) == 0) {
+        used++;
+        live++;
+        current->values[slot].store(PlayerID, std::memory_order_release);
+        current->keys[slot].store(GroupID, std::memory_order_release);
+        return;
+    }
+
+    if (current->values[slot].load(std::memory_order_relaxed) == NO_GROUP)
+        live++;
+    current->values[slot].store(PlayerID, std::memory_order_release);
+}
+
+void PublishedHighest::remove(int GroupID)
+{
+    Table* current = table.load(std::memory_order_relaxed);
+    if (current == NULL)
+        return;
+
+    // the key stays until the next rehash, so the probes that pass through it still work
+    int slot = slotOf(current, GroupID);
+    if (current->keys[slot].load(std::memory_order_relaxed) == GroupID
+        && current->values[slot].load(std::memory_order_relaxed) != NO_GROUP) {
+        current->values[slot].store(NO_GROUP, std::memory_order_release);
+        live--;
+    }
+}
+
+int PublishedHighest::highestOf(int GroupID) const
+{
+    uint64_t entered = enter();
+    const Table* current = table.load(std::memory_order_acquire);
+
+    int result = NO_GROUP;
+    if (current != NULL) {
+        int slot = hashOf(GroupID, current->capacity);
+        while (true) {
+            int key = current->keys[slot].load(std::memory_order_acquire);
+            if (key == GroupID) {
+                result = current->values[slot].load(std::memory_order_acquire);
+                break;
+            }
+            if (key == 0)
+                break;
+            slot = (slot + 1) & (current->capacity - 1);
+        }
+    }
+
+    leave(entered);
+    return result;
+}
@@ -0,0 +1,59 @@
+#ifndef PUBLISHED_HIGHEST
+#define PUBLISHED_HIGHEST
+
+#include <atomic>
+#include <cstdint>
+
+/// <summary>
+/// The answers of GetHighestLevel, kept current by the writer and read without any lock.
+/// Each answer is a player id in an atomic, so a reader never touches a Player or a tree node.
+/// The per-group answers live in an open-addressing table keyed by GroupID. The table is only
+/// replaced when it grows; readers announce themselves in the current epoch, and the writer
+/// frees the replaced table once every reader that could still see it has left.
+/// There must be at most one writer at a time, the manager's exclusive lock sees to that.
+/// </summary>
+class PublishedHighest
+{
+	struct Table
+	{
+		int capacity; // a power of 2
+		std::atomic<int>* keys; // 0 for a free slot, group ids are positive
+		std::atomic<int>* values;
+	};
+
+	std::atomic<Table*> table;
+	int used; // slots with a key, removed groups included
+	int live; // groups that were not removed
+	std::atomic<int> global;
+
+	std::atomic<uint64_t> epoch;
+	mutable std::atomic<int> readers[2]; // readers inside an epoch of each parity
+
+	static Table* createTable(int capacity); // NULL if out of memory
+	static void destroyTable(Table* old);
+	static int slotOf(const Table* t, int GroupID); // the key's slot, or the free slot that ends its probe
+	uint64_t enter() const;
+	void leave(uint64_t entered) const;
+	// waits until no reader that entered before the call is left
+	void synchronize();
+
+public:
+	static const int NO_GROUP = -2;
+
+	PublishedHighest();
+	~PublishedHighest();
+	PublishedHighest(const PublishedHighest&) = delete;
+	PublishedHighest& operator=(const PublishedHighest&) = delete;
+
+	// writer side. publish may only add a group after reserve made room for it
+	bool reserve(int numOfGroups); // false if out of memory
+	void publish(int GroupID, int PlayerID);
+	void remove(int GroupID);
+	void publishGlobal(int PlayerID) { global.store(PlayerID, std::memory_order_release); }
+
+	// reader side, lock-free. -1 for no players, NO_GROUP if there is no such group
+	int highestOf(int GroupID) const;
+	int highest() const { return global.load(std::memory_order_acquire); }
+};
+
+#endif // PUBLISHED_HIGHEST
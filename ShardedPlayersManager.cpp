@@ -0,0 +1,389 @@
+#include "ShardedPlayersManager.h"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// below this many items a global query gathers on the calling thread, starting threads costs more
+static const int PARALLEL_THRESHOLD = 1 << 14;
+
+
+/* ------------------------------------------ ShardedPlayersManager Functions ------------------------------------------ */
+
+
+ShardedPlayersManager::ShardedPlayersManager(int numOfShards) : DataStructure(true), numOfShards(numOfShards)
+{
+    shards = new PlayersManager*[numOfShards];
+    for (int i = 0; i < numOfShards; i++)
+        shards[i] = new PlayersManager(true);
+    directory = new DirectorySlice[numOfShards];
+}
+
+ShardedPlayersManager::~ShardedPlayersManager()
+{
+    for (int i = 0; i < numOfShards; i++)
+        delete shards[i];
+    delete[] shards;
+    delete[] directory;
+}
+
+template <typename Work>
+void ShardedPlayersManager::forEachShard(Work& work, bool parallel)
+{
+    vector<std::thread> workers;
+    int started = 1; // shard 0 always runs here
+    try
+    {
+        if (parallel) {
+            workers.reserve(numOfShards - 1);
+            for (; started < numOfShards; started++)
+                workers.emplace_back(std::ref(work), started);
+        }
+    }
+    catch (const std::exception&) {
+        // out of threads or memory, the shards left run here
+    }
+
+    for (int i = started; i < numOfShards; i++)
+        work(i);
+    work(0);
+    for (auto& worker : workers)
+        worker.join();
+}
+
+StatusType ShardedPlayersManager::AddGroup(int GroupID)
+{
+    if (GroupID <= 0) return INVALID_INPUT;
+
+    PlayersManager* shard = shards[shardOf(GroupID)];
+    auto lock = shard->lockExclusive();
+    return shard->AddGroup(GroupID);
+}
+
+StatusType ShardedPlayersManager::AddPlayer(int PlayerID, int GroupID, int Level)
+{
+    if (PlayerID <= 0 || GroupID <= 0 || Level < 0) {
+        return INVALID_INPUT;
+    }
+
+    DirectorySlice& slice = directory[shardOf(PlayerID)];
+    std::unique_lock<std::shared_mutex> sliceLock(slice.lock);
+
+    // the id is claimed first, so a failure in the shard is the only thing to undo
+    int to = shardOf(GroupID);
+    AVLNode<PlayerShard>* entry;
+    TreeResult claimed = slice.players.insertNode(PlayerShard{ PlayerID, to }, &entry);
+    if (claimed == TreeResult::NODE_ALREADY_EXISTS) return FAILURE;
+    if (claimed != TreeResult::SUCCESS) return ALLOCATION_ERROR;
+
+    StatusType result;
+    {
+        auto lock = shards[to]->lockExclusive();
+        result = shards[to]->AddPlayer(PlayerID, GroupID, Level);
+    }
+    if (result != SUCCESS)
+        slice.players.deleteByPointer(entry);
+    return result;
+}
+
+StatusType ShardedPlayersManager::RemovePlayer(int PlayerID)
+{
+    if (PlayerID <= 0) return INVALID_INPUT;
+
+    DirectorySlice& slice = directory[shardOf(PlayerID)];
+    std::unique_lock<std::shared_mutex> sliceLock(slice.lock);
+    PlayerShard* entry = slice.players.findData(PlayerID);
+    if (entry == NULL) return FAILURE;
+
+    StatusType result;
+    {
+        auto lock = shards[entry->shard]->lockExclusive();
+        result = shards[entry->shard]->RemovePlayer(PlayerID);
+    }
+    if (result == SUCCESS)
+        slice.players.deleteNode(PlayerID);
+    return result;
+}
+
+StatusType ShardedPlayersManager::IncreaseLevel(int PlayerID, int LevelIncrease)
+{
+    if (PlayerID <= 0 || LevelIncrease <= 0)
+        return INVALID_INPUT;
+
+    DirectorySlice& slice = directory[shardOf(PlayerID)];
+    std::shared_lock<std::shared_mutex> sliceLock(slice.lock);
+    PlayerShard* entry = slice.players.findData(PlayerID);
+    if (entry == NULL) return FAILURE;
+
+    auto lock = shards[entry->shard]->lockExclusive();
+    return shards[entry->shard]->IncreaseLevel(PlayerID, LevelIncrease);
+}
+
+StatusType ShardedPlayersManager::ApplyBatch(const BatchOp* ops, int numOfOps, StatusType* results)
+{
+    if (numOfOps < 0 || ((ops == NULL || results == NULL) && numOfOps > 0))
+        return INVALID_INPUT;
+
+    for (int i = 0; i < numOfOps; i++) {
+        const BatchOp& op = ops[i];
+        switch (op.type) {
+        case BATCH_ADD_GROUP:
+            results[i] = AddGroup(op.arg1);
+            break;
+        case BATCH_ADD_PLAYER:
+            results[i] = AddPlayer(op.arg1, op.arg2, op.arg3);
+            break;
+        case BATCH_REMOVE_PLAYER:
+            results[i] = RemovePlayer(op.arg1);
+            break;
+        case BATCH_REPLACE_GROUP:
+            results[i] = ReplaceGroup(op.arg1, op.arg2);
+            break;
+        case BATCH_INCREASE_LEVEL:
+            results[i] = IncreaseLevel(op.arg1, op.arg2);
+            break;
+        default:
+            results[i] = INVALID_INPUT;
+            break;
+        }
+    }
+    return SUCCESS;
+}
+
+StatusType ShardedPlayersManager::ReplaceGroup(int GroupID, int ReplacementID)
+{
+    if(GroupID <= 0 || ReplacementID <= 0 || GroupID == ReplacementID){
+        return INVALID_INPUT;
+    }
+
+    int from = shardOf(GroupID);
+    int to = shardOf(ReplacementID);
+    if (from == to) {
+        auto lock = shards[from]->lockExclusive();
+        return shards[from]->ReplaceGroup(GroupID, ReplacementID);
+    }
+
+    try
+    {
+        // the group's players change shard, and they may be in any directory slice
+        vector<std::unique_lock<std::shared_mutex> > locks;
+        locks.reserve(numOfShards + 2);
+        for (int i = 0; i < numOfShards; i++)
+            locks.emplace_back(directory[i].lock);
+        locks.push_back(shards[std::min(from, to)]->lockExclusive());
+        locks.push_back(shards[std::max(from, to)]->lockExclusive());
+
+        Group* group = shards[from]->groupTree->findData(GroupID);
+        if (!group || !shards[to]->groupTree->findData(ReplacementID))
+            return FAILURE;
+
+        return migrateGroup(group, from, ReplacementID, to);
+    }
+    catch (const bad_alloc&) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType ShardedPlayersManager::migrateGroup(Group* group, int from, int ReplacementID, int to)
+{
+    vector<PlayerEntry> players;
+    players.reserve(group->getSize());
+    for (auto it = group->groupPlayers->begin(); it != group->groupPlayers->end(); ++it) {
+        PlayerEntry entry;
+        entry.PlayerID = it->player->getId();
+        entry.GroupID = ReplacementID;
+        entry.Level = it->player->getLevel();
+        players.push_back(entry);
+    }
+
+    // the replacement takes the players first, it is the only step that can fail
+    StatusType result = shards[to]->AddPlayersBulk(players.data(), (int)players.size());
+    if (result != SUCCESS)
+        return result;
+
+    shards[from]->removeGroup(group);
+    for (size_t i = 0; i < players.size(); i++)
+        directory[shardOf(players[i].PlayerID)].players.findData(players[i].PlayerID)->shard = to;
+    return SUCCESS;
+}
+
+StatusType ShardedPlayersManager::GetHighestLevel(int GroupID, int* PlayerID)
+{
+    if(GroupID == 0 || !PlayerID){
+        return INVALID_INPUT;
+    }
+    if (GroupID > 0)
+        return shards[shardOf(GroupID)]->GetHighestLevelLockFree(GroupID, PlayerID);
+
+    // one key per shard, not worth a thread. The shards are locked because a group that moves
+    // is briefly in both, and reading them one by one without locks could miss its players.
+    try
+    {
+        vector<std::shared_lock<std::shared_mutex> > locks;
+        locks.reserve(numOfShards);
+        PlayerPointer* highest = NULL;
+        for (int i = 0; i < numOfShards; i++) {
+            locks.push_back(shards[i]->lockShared());
+            PlayerPointer* candidate = shards[i]->playersByLevel->getHighest();
+            if (candidate != NULL && (highest == NULL || candidate->key > highest->key))
+                highest = candidate;
+        }
+
+        *PlayerID = highest == NULL ? -1 : highest->player->getId();
+        return SUCCESS;
+    }
+    catch (const bad_alloc&) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType ShardedPlayersManager::GetAllPlayersByLevel(int GroupID, int** Players, int* numOfPlayers)
+{
+    if (GroupID == 0 || !Players || !numOfPlayers)
+        return INVALID_INPUT;
+    if (GroupID > 0) {
+        PlayersManager* shard = shards[shardOf(GroupID)];
+        auto lock = shard->lockShared();
+        return shard->GetAllPlayersByLevel(GroupID, Players, numOfPlayers);
+    }
+
+    try
+    {
+        // every shard's players by level, highest first, read together so no group moves meanwhile
+        vector<vector<uint64_t> > keys(numOfShards);
+        vector<char> failed(numOfShards, 0);
+        {
+            vector<std::shared_lock<std::shared_mutex> > locks;
+            locks.reserve(numOfShards);
+            int total = 0;
+            for (int i = 0; i < numOfShards; i++) {
+                locks.push_back(shards[i]->lockShared());
+                total += shards[i]->playersByLevel->getSize();
+            }
+
+            auto gather = [&](int i) {
+                try
+                {
+                    LevelTree* tree = shards[i]->playersByLevel;
+                    keys[i].reserve(tree->getSize());
+                    for (auto it = tree->rbegin(); it != tree->rend(); ++it)
+                        keys[i].push_back(it->key);
+                }
+                catch (const bad_alloc&) {
+                    failed[i] = 1;
+                }
+            };
+            forEachShard(gather, total >= PARALLEL_THRESHOLD);
+        }
+
+        int count = 0;
+        for (int i = 0; i < numOfShards; i++) {
+            if (failed[i])
+                return ALLOCATION_ERROR;
+            count += (int)keys[i].size();
+        }
+
+        // k-way merge on the keys, which hold the id as well. The heap never grows past its first
+        // fill, so nothing throws once the result is allocated.
+        typedef pair<uint64_t, int> Head; // key, shard
+        priority_queue<Head> heads;
+        vector<size_t> next(numOfShards, 0);
+        for (int i = 0; i < numOfShards; i++) {
+            if (!keys[i].empty())
+                heads.push(Head(keys[i][0], i));
+        }
+
+        int* players = (int*)malloc(count * sizeof(int));
+        if (players == NULL && count > 0)
+            return ALLOCATION_ERROR;
+        for (int j = 0; !heads.empty(); j++) {
+            Head head = heads.top();
+            heads.pop();
+            players[j] = PlayerPointer::idOfKey(head.first);
+            if (++next[head.second] < keys[head.second].size())
+                heads.push(Head(keys[head.second][next[head.second]], head.second));
+        }
+
+        *numOfPlayers = count;
+        *Players = players;
+        return SUCCESS;
+    }
+    catch (const bad_alloc&) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType ShardedPlayersManager::GetGroupsHighestLevel(int numOfGroups, int** Players)
+{
+    if(numOfGroups < 1 || !Players){
+        return INVALID_INPUT;
+    }
+
+    try
+    {
+        // the first numOfGroups non-empty groups of every shard, as (group id, highest player id)
+        typedef pair<int, int> GroupHighest;
+        vector<vector<GroupHighest> > firsts(numOfShards);
+        vector<char> failed(numOfShards, 0);
+        {
+            vector<std::shared_lock<std::shared_mutex> > locks;
+            locks.reserve(numOfShards);
+            int total = 0;
+            for (int i = 0; i < numOfShards; i++) {
+                locks.push_back(shards[i]->lockShared());
+                total += shards[i]->NonEmptyGroups->getSize();
+            }
+            if (numOfGroups > total)
+                return FAILURE;
+
+            auto gather = [&](int i) {
+                try
+                {
+                    GroupPointerTree* groups = shards[i]->NonEmptyGroups;
+                    int count = std::min(numOfGroups, groups->getSize());
+                    firsts[i].reserve(count);
+                    auto it = groups->begin();
+                    for (int j = 0; j < count; j++, ++it)
+                        firsts[i].push_back(GroupHighest(it->group->getGroupId(), it->group->highest_player->player->getId()));
+                }
+                catch (const bad_alloc&) {
+                    failed[i] = 1;
+                }
+            };
+            forEachShard(gather, (long long)numOfGroups * numOfShards >= PARALLEL_THRESHOLD);
+        }
+
+        for (int i = 0; i < numOfShards; i++) {
+            if (failed[i])
+                return ALLOCATION_ERROR;
+        }
+
+        // k-way merge by group id, lowest first
+        typedef pair<GroupHighest, int> Head; // group, shard
+        priority_queue<Head, vector<Head>, greater<Head> > heads;
+        vector<size_t> next(numOfShards, 0);
+        for (int i = 0; i < numOfShards; i++) {
+            if (!firsts[i].empty())
+                heads.push(Head(firsts[i][0], i));
+        }
+
+        int* highestPlayers = (int*)malloc(numOfGroups * sizeof(int));
+        if (highestPlayers == NULL)
+            return ALLOCATION_ERROR;
+        for (int j = 0; j < numOfGroups; j++) {
+            Head head = heads.top();
+            heads.pop();
+            highestPlayers[j] = head.first.second;
+            if (++next[head.second] < firsts[head.second].size())
+                heads.push(Head(firsts[head.second][next[head.second]], head.second));
+        }
+
+        *Players = highestPlayers;
+        return SUCCESS;
+    }
+    catch (const bad_alloc&) {
+        return ALLOCATION_ERROR;
+    }
+}
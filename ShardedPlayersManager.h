@@ -0,0 +1,66 @@
+#ifndef SHARDED_PLAYERS_MANAGER
+#define SHARDED_PLAYERS_MANAGER
+
+#include "PlayersManager.h"
+
+// which shard holds a player, the shard of its group
+struct PlayerShard
+{
+	int id;
+	int shard;
+};
+
+struct PlayerShardKey
+{
+	typedef int Key;
+	static int key(const PlayerShard& ps) { return ps.id; }
+};
+
+typedef AVLTree<PlayerShard, PlayerShardKey> ShardDirectory;
+
+/// <summary>
+/// Splits the groups over numOfShards concurrent PlayersManagers by GroupID, so calls about
+/// different groups lock different shards and run in parallel. A player lives in its group's
+/// shard; calls that only name a player find it through a directory, itself split by PlayerID.
+/// The global queries lock every shard for reading, gather from them in parallel and merge.
+/// Locks are always taken directory slices first, then shards, each in index order.
+/// </summary>
+class ShardedPlayersManager : public DataStructure
+{
+	struct DirectorySlice
+	{
+		ShardDirectory players;
+		std::shared_mutex lock;
+	};
+
+	int numOfShards;
+	PlayersManager** shards;
+	DirectorySlice* directory;
+
+	int shardOf(int id) const { return id % numOfShards; }
+	// runs work(i) for every shard i; if parallel, on a thread of its own where one can be started
+	template <typename Work>
+	void forEachShard(Work& work, bool parallel);
+	// moves the group's players to the replacement in its shard and drops the group, with every lock held
+	StatusType migrateGroup(Group* group, int from, int ReplacementID, int to);
+
+public:
+	explicit ShardedPlayersManager(int numOfShards);
+	~ShardedPlayersManager();
+	ShardedPlayersManager(const ShardedPlayersManager&) = delete;
+	ShardedPlayersManager& operator=(const ShardedPlayersManager&) = delete;
+
+	// same contracts as PlayersManager's
+	StatusType AddGroup(int GroupID);
+	StatusType AddPlayer(int PlayerID, int GroupID, int Level);
+	StatusType RemovePlayer(int PlayerID);
+	StatusType ReplaceGroup(int GroupID, int ReplacementID);
+	StatusType IncreaseLevel(int PlayerID, int LevelIncrease);
+	// the calls one by one, each locks only what it needs
+	StatusType ApplyBatch(const BatchOp* ops, int numOfOps, StatusType* results);
+	StatusType GetHighestLevel(int GroupID, int* PlayerID);
+	StatusType GetAllPlayersByLevel(int GroupID, int** Players, int* numOfPlayers);
+	StatusType GetGroupsHighestLevel(int numOfGroups, int** Players);
+};
+
+#endif // SHARDED_PLAYERS_MANAGER
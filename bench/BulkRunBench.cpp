@@ -0,0 +1,58 @@
+/*
+ * A run of m new players added by m AddPlayer calls against one AddPlayersBulk, on a manager
+ * that already holds numOfPlayers players in numOfGroups groups, not part of the library build.
+ * The new ids fall between the existing ones. ApplyBatch sends a run through the bulk from the
+ * length where the bulk starts to win (BULK_RUN_MIN in PlayersManager.cpp).
+ *
+ *   g++ -std=c++17 -O2 -pthread -Dsscanf_s=sscanf -I.. BulkRunBench.cpp \
+ *       $(find .. -maxdepth 1 -name "*.cpp" ! -name main1.cpp) -o BulkRunBench
+ *   ./BulkRunBench [players=1000000] [groups=1000]
+ */
+
+#include "library1.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace std::chrono;
+
+int main(int argc, char** argv)
+{
+    int numOfPlayers = argc > 1 ? atoi(argv[1]) : 1000000;
+    int numOfGroups = argc > 2 ? atoi(argv[2]) : 1000;
+
+    for (int runLength = 16; runLength <= 32768; runLength *= 2) {
+        // a fresh manager per mode, and few enough runs that the manager keeps its size
+        int numOfRuns = std::max(4, std::min(100000 / runLength, numOfPlayers / (4 * runLength)));
+        double seconds[2];
+        for (int bulk = 0; bulk < 2; bulk++) {
+            void* DS = Init();
+            for (int g = 1; g <= numOfGroups; g++)
+                AddGroup(DS, g);
+            for (int i = 1; i <= numOfPlayers; i++)
+                AddPlayer(DS, 2 * i, i % numOfGroups + 1, i % 997);
+
+            std::vector<PlayerEntry> run(runLength);
+            int nextId = 1;
+            auto start = steady_clock::now();
+            for (int r = 0; r < numOfRuns; r++) {
+                for (int j = 0; j < runLength; j++, nextId += 2) {
+                    run[j].PlayerID = nextId;
+                    run[j].GroupID = nextId % numOfGroups + 1;
+                    run[j].Level = nextId % 991;
+                    if (!bulk)
+                        AddPlayer(DS, run[j].PlayerID, run[j].GroupID, run[j].Level);
+                }
+                if (bulk)
+                    AddPlayersBulk(DS, run.data(), runLength);
+            }
+            seconds[bulk] = duration<double>(steady_clock::now() - start).count() / numOfRuns;
+            Quit(&DS);
+        }
+        printf("run %5d  calls %9.1fus  bulk %9.1fus  bulk/calls %.2f\n", runLength,
+            seconds[0] * 1e6, seconds[1] * 1e6, seconds[1] / seconds[0]);
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * Read/write throughput of a manager shared by 1-32 threads, not part of the library build.
+ *
+ * Each thread runs a mix of queries (GetHighestLevel, GetTopPlayersByLevel, GetPlayerRank,
+ * CountPlayersInLevelRange) and writes (IncreaseLevel, RemovePlayer + AddPlayer) at 0%, 10% and
+ * 50% writes. "mutex" is an Init() manager behind one external mutex, every call serialized;
+ * "rwlock" is an InitConcurrent() manager, whose queries run in parallel.
+ *
+ *   g++ -std=c++17 -O2 -pthread -Dsscanf_s=sscanf -I.. ConcurrencyBench.cpp \
+ *       $(find .. -maxdepth 1 -name "*.cpp" ! -name main1.cpp) -o ConcurrencyBench
+ *   ./ConcurrencyBench [players=20000] [operations=200000]
+ *
+ * The queries only scale with the cores the machine has; on one core both modes are the same.
+ */
+
+#include "library1.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const int NUM_OF_GROUPS = 64;
+
+static void runThread(void* DS, std::mutex* serialize, int seed, int numOfPlayers, int numOfOps, int writePercent)
+{
+    unsigned state = seed * 7919 + 1;
+    int page[100];
+    for (int i = 0; i < numOfOps; i++) {
+        state = state * 1103515245 + 12345;
+        int roll = (state >> 8) % 100;
+        int id = 1 + (state >> 4) % numOfPlayers;
+        int group = 1 + id % NUM_OF_GROUPS;
+
+        std::unique_lock<std::mutex> lock;
+        if (serialize != NULL)
+            lock = std::unique_lock<std::mutex>(*serialize);
+
+        int result;
+        if (roll < writePercent) {
+            if (roll % 2) {
+                IncreaseLevel(DS, id, 1);
+            }
+            else {
+                RemovePlayer(DS, id);
+                AddPlayer(DS, id, group, id % 1000);
+            }
+            continue;
+        }
+        switch (roll % 4) {
+        case 0:
+            GetHighestLevel(DS, group, &result);
+            break;
+        case 1:
+            GetTopPlayersByLevel(DS, -1, 100, id % 1000, page, &result);
+            break;
+        case 2:
+            GetPlayerRank(DS, id, -1, &result);
+            break;
+        default:
+            CountPlayersInLevelRange(DS, group, 10, 500, &result);
+            break;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int numOfPlayers = argc > 1 ? atoi(argv[1]) : 20000;
+    int numOfOps = argc > 2 ? atoi(argv[2]) : 200000;
+    const int writePercents[] = { 0, 10, 50 };
+    const int threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+
+    for (int concurrent = 0; concurrent < 2; concurrent++) {
+        for (int writePercent : writePercents) {
+            for (int numOfThreads : threadCounts) {
+                void* DS = concurrent ? InitConcurrent() : Init();
+                for (int g = 1; g <= NUM_OF_GROUPS; g++)
+                    AddGroup(DS, g);
+                for (int i = 1; i <= numOfPlayers; i++)
+                    AddPlayer(DS, i, 1 + i % NUM_OF_GROUPS, i % 1000);
+
+                std::mutex serialize;
+                std::vector<std::thread> threads;
+                auto start = std::chrono::steady_clock::now();
+                for (int t = 0; t < numOfThreads; t++)
+                    threads.emplace_back(runThread, DS, concurrent ? (std::mutex*)NULL : &serialize, t,
+                        numOfPlayers, numOfOps / numOfThreads, writePercent);
+                for (auto& thread : threads)
+                    thread.join();
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                printf("%s writes=%2d%% threads=%2d  %10.0f ops/s\n", concurrent ? "rwlock" : "mutex ",
+                    writePercent, numOfThreads, numOfOps / seconds);
+                Quit(&DS);
+            }
+        }
+    }
+    return 0;
+}
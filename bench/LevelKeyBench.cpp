@@ -0,0 +1,86 @@
+/*
+ * Level-tree insert and search, ordered by the packed PlayerPointer key against the same order
+ * read through the Player behind each node (how the level trees compared before the key was
+ * stored inline). Not part of the library build.
+ *
+ *   g++ -std=c++17 -O2 -I.. LevelKeyBench.cpp -o LevelKeyBench
+ *   ./LevelKeyBench [players=1000000]
+ */
+
+#include "PlayersManager.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace std::chrono;
+
+// the order of PlayerLevelKey, found by loading the Player: level, then the lower id first
+struct PlayerThroughPointer
+{
+    typedef const Player* Key;
+    static const Player* key(const PlayerPointer& pp) { return pp.player; }
+};
+
+struct LevelThenIdCompare
+{
+    static int compare(const Player* a, const Player* b) {
+        if (a->getLevel() != b->getLevel())
+            return a->getLevel() < b->getLevel() ? -1 : 1;
+        return a->getId() > b->getId() ? -1 : (a->getId() < b->getId() ? 1 : 0);
+    }
+};
+
+typedef AVLTree<PlayerPointer, PlayerThroughPointer, LevelThenIdCompare> PointerLevelTree;
+
+static double secondsSince(steady_clock::time_point start)
+{
+    return duration<double>(steady_clock::now() - start).count();
+}
+
+// inserts every player, then looks each one up by its key in another order
+template <typename Tree, typename KeyOf>
+static void run(const char* name, std::vector<Player*> players, std::mt19937& random)
+{
+    Tree tree;
+    AVLNode<PlayerPointer>* node = NULL;
+    auto start = steady_clock::now();
+    for (size_t i = 0; i < players.size(); i++)
+        tree.insertNode(PlayerPointer(players[i]), &node);
+    double insertTime = secondsSince(start);
+
+    std::shuffle(players.begin(), players.end(), random);
+    long long checksum = 0;
+    start = steady_clock::now();
+    for (size_t i = 0; i < players.size(); i++)
+        checksum += tree.rank(KeyOf::key(PlayerPointer(players[i])));
+    double searchTime = secondsSince(start);
+
+    printf("%-16s insert %.3fs  search %.3fs  (%lld)\n", name, insertTime, searchTime, checksum);
+}
+
+int main(int argc, char** argv)
+{
+    int numOfPlayers = argc > 1 ? atoi(argv[1]) : 1000000;
+    std::mt19937 random(3);
+    std::vector<int> ids(numOfPlayers);
+    for (int i = 0; i < numOfPlayers; i++)
+        ids[i] = i + 1;
+    std::shuffle(ids.begin(), ids.end(), random);
+
+    // the players live in an id tree as in the manager, so the pointed-to data is spread out
+    PlayerTree byId;
+    std::vector<Player*> players(numOfPlayers);
+    for (int i = 0; i < numOfPlayers; i++) {
+        AVLNode<Player>* node = NULL;
+        byId.insertNode(Player(ids[i], random() % 100000, nullptr), &node);
+        players[i] = node->getData();
+    }
+
+    std::mt19937 order1(5), order2(5);
+    run<PointerLevelTree, PlayerThroughPointer>("through Player", players, order1);
+    run<LevelTree, PlayerLevelKey>("packed key", players, order2);
+    return 0;
+}
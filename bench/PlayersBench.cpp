@@ -0,0 +1,81 @@
+/*
+ * Timings of the main calls on a large manager, not part of the library build.
+ *
+ * Adds numOfPlayers players with shuffled ids to 1000 groups, then times IncreaseLevel,
+ * GetAllPlayersByLevel, ReplaceGroup, RemovePlayer and Quit on them. It only uses the calls the
+ * library always had, so the same driver can be built against an older checkout of the sources
+ * (with that checkout's .cpp files) to compare two versions.
+ *
+ *   g++ -std=c++17 -O2 -pthread -Dsscanf_s=sscanf -I.. PlayersBench.cpp \
+ *       $(find .. -maxdepth 1 -name "*.cpp" ! -name main1.cpp) -o PlayersBench
+ *   ./PlayersBench [players=1000000]
+ */
+
+#include "library1.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace std::chrono;
+
+static const int NUM_OF_GROUPS = 1000;
+
+static double secondsSince(steady_clock::time_point start)
+{
+    return duration<double>(steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    int numOfPlayers = argc > 1 ? atoi(argv[1]) : 1000000;
+    std::mt19937 random(1);
+    std::vector<int> ids(numOfPlayers);
+    for (int i = 0; i < numOfPlayers; i++)
+        ids[i] = i + 1;
+    std::shuffle(ids.begin(), ids.end(), random);
+
+    void* DS = Init();
+    for (int g = 1; g <= NUM_OF_GROUPS; g++)
+        AddGroup(DS, g);
+
+    auto start = steady_clock::now();
+    for (int i = 0; i < numOfPlayers; i++)
+        AddPlayer(DS, ids[i], ids[i] % NUM_OF_GROUPS + 1, random() % 1000);
+    printf("AddPlayer            %.2fs\n", secondsSince(start));
+
+    start = steady_clock::now();
+    for (int i = 0; i < numOfPlayers; i++)
+        IncreaseLevel(DS, ids[(long long)i * 7 % numOfPlayers], 1 + random() % 5);
+    printf("IncreaseLevel        %.2fs\n", secondsSince(start));
+
+    start = steady_clock::now();
+    int* players;
+    int count;
+    for (int i = 0; i < 200; i++) {
+        GetAllPlayersByLevel(DS, i % NUM_OF_GROUPS + 1, &players, &count);
+        free(players);
+    }
+    for (int i = 0; i < 5; i++) {
+        GetAllPlayersByLevel(DS, -1, &players, &count);
+        free(players);
+    }
+    printf("GetAllPlayersByLevel %.2fs\n", secondsSince(start));
+
+    start = steady_clock::now();
+    for (int g = 1; g < NUM_OF_GROUPS; g += 2)
+        ReplaceGroup(DS, g, g + 1);
+    printf("ReplaceGroup         %.2fs\n", secondsSince(start));
+
+    start = steady_clock::now();
+    for (int i = 0; i < numOfPlayers / 2; i++)
+        RemovePlayer(DS, ids[i]);
+    printf("RemovePlayer         %.2fs\n", secondsSince(start));
+
+    start = steady_clock::now();
+    Quit(&DS);
+    printf("Quit                 %.3fs\n", secondsSince(start));
+    return 0;
+}
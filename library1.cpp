@@ -1,71 +1,332 @@
 #include "PlayersManager.h"
+#include "ShardedPlayersManager.h"
+#include "FrozenSnapshot.h"
+
+// every DS is handed out as a DataStructure*, which tells which manager it is
+static bool isSharded(void* DS) { return ((DataStructure*)DS)->sharded; }
+static PlayersManager* asManager(void* DS) { return static_cast<PlayersManager*>((DataStructure*)DS); }
+static ShardedPlayersManager* asSharded(void* DS) { return static_cast<ShardedPlayersManager*>((DataStructure*)DS); }
 
 
 void* Init()
 {
-	return new PlayersManager();
+	return static_cast<DataStructure*>(new PlayersManager());
+}
+
+void* InitConcurrent()
+{
+	return static_cast<DataStructure*>(new PlayersManager(true));
+}
+
+void* InitSharded(int numOfShards)
+{
+	if (numOfShards < 1)
+		return NULL;
+	return static_cast<DataStructure*>(new ShardedPlayersManager(numOfShards));
 }
 
 StatusType AddGroup(void* DS, int GroupID)
 {
 	if (DS == NULL)
 		return INVALID_INPUT;
-	return ((PlayersManager*)DS)->AddGroup(GroupID);
+	if (isSharded(DS))
+		return asSharded(DS)->AddGroup(GroupID);
+	auto lock = asManager(DS)->lockExclusive();
+	return asManager(DS)->AddGroup(GroupID);
 }
 
 StatusType AddPlayer(void* DS, int PlayerID, int GroupID, int Level)
 {
 	if (DS == NULL)
 		return INVALID_INPUT;
-	return ((PlayersManager*)DS)->AddPlayer(PlayerID, GroupID, Level);
+	if (isSharded(DS))
+		return asSharded(DS)->AddPlayer(PlayerID, GroupID, Level);
+	auto lock = asManager(DS)->lockExclusive();
+	return asManager(DS)->AddPlayer(PlayerID, GroupID, Level);
+}
+
+StatusType AddPlayersBulk(void* DS, const PlayerEntry* Players, int numOfPlayers)
+{
+	if (DS == NULL)
+		return INVALID_INPUT;
+	if (isSharded(DS))
+		return FAILURE;
+	auto lock = asManager(DS)->lockExclusive();
+	return asManager(DS)->AddPlayersBulk(Players, numOfPlayers);
 }
 
 StatusType RemovePlayer(void* DS, int PlayerID)
 {
 	if (DS == NULL)
 		return INVALID_INPUT;
-	return ((PlayersManager*)DS)->RemovePlayer(PlayerID);
+	if (isSharded(DS))
+		return asSharded(DS)->RemovePlayer(PlayerID);
+	auto lock = asManager(DS)->lockExclusive();
+	return asManager(DS)->RemovePlayer(PlayerID);
 }
 
 StatusType ReplaceGroup(void* DS, int GroupID, int ReplacementID)
 {
 	if (DS == NULL)
 		return INVALID_INPUT;
-	return ((PlayersManager*)DS)->ReplaceGroup(GroupID, ReplacementID);
+	if (isSharded(DS))
+		return asSharded(DS)->ReplaceGroup(GroupID, ReplacementID);
+	auto lock = asManager(DS)->lockExclusive();
+	return asManager(DS)->ReplaceGroup(GroupID, ReplacementID);
 }
 
 StatusType IncreaseLevel(void* DS, int PlayerID, int LevelIncrease)
 {
 	if (DS == NULL)
 		return INVALID_INPUT;
-	return ((PlayersManager*)DS)->IncreaseLevel(PlayerID, LevelIncrease);
+	if (isSharded(DS))
+		return asSharded(DS)->IncreaseLevel(PlayerID, LevelIncrease);
+	auto lock = asManager(DS)->lockExclusive();
+	return asManager(DS)->IncreaseLevel(PlayerID, LevelIncrease);
+}
+
+StatusType ApplyBatch(void* DS, const BatchOp* ops, int numOfOps, StatusType* results)
+{
+	if (DS == NULL)
+		return INVALID_INPUT;
+	if (isSharded(DS))
+		return asSharded(DS)->ApplyBatch(ops, numOfOps, results);
+	auto lock = asManager(DS)->lockExclusive();
+	return asManager(DS)->ApplyBatch(ops, numOfOps, results);
 }
 
 StatusType GetHighestLevel(void* DS, int GroupID, int* PlayerID)
 {
 	if (DS == NULL)
 		return INVALID_INPUT;
-	return ((PlayersManager*)DS)->GetHighestLevel(GroupID, PlayerID);
+	if (isSharded(DS))
+		return asSharded(DS)->GetHighestLevel(GroupID, PlayerID);
+	// the hottest call, concurrent managers answer it without the lock
+	if (asManager(DS)->isConcurrent())
+		return asManager(DS)->GetHighestLevelLockFree(GroupID, PlayerID);
+	return asManager(DS)->GetHighestLevel(GroupID, PlayerID);
 }
 
 StatusType GetAllPlayersByLevel(void* DS, int GroupID, int** Players, int* numOfPlayers)
 {
 	if (DS == NULL)
 		return INVALID_INPUT;
-	return ((PlayersManager*)DS)->GetAllPlayersByLevel(GroupID, Players, numOfPlayers);
+	if (isSharded(DS))
+		return asSharded(DS)->GetAllPlayersByLevel(GroupID, Players, numOfPlayers);
+	auto lock = asManager(DS)->lockShared();
+	return asManager(DS)->GetAllPlayersByLevel(GroupID, Players, numOfPlayers);
+}
+
+StatusType GetAllPlayersByLevelInto(void* DS, int GroupID, int* Players, int capacity, int* numOfPlayers)
+{
+	if (DS == NULL)
+		return INVALID_INPUT;
+	if (isSharded(DS))
+		return FAILURE;
+	auto lock = asManager(DS)->lockShared();
+	return asManager(DS)->GetAllPlayersByLevelInto(GroupID, Players, capacity, numOfPlayers);
+}
+
+StatusType ForEachPlayerByLevel(void* DS, int GroupID, PlayerVisitor visit, void* context)
+{
+	if (DS == NULL)
+		return INVALID_INPUT;
+	if (isSharded(DS))
+		return FAILURE;
+	auto lock = asManager(DS)->lockShared();
+	return asManager(DS)->ForEachPlayerByLevel(GroupID, visit, context);
+}
+
+StatusType GetTopPlayersByLevel(void* DS, int GroupID, int k, int offset, int* Players, int* numOfPlayers)
+{
+	if (DS == NULL)
+		return INVALID_INPUT;
+	if (isSharded(DS))
+		return FAILURE;
+	auto lock = asManager(DS)->lockShared();
+	return asManager(DS)->GetTopPlayersByLevel(GroupID, k, offset, Players, numOfPlayers);
+}
+
+StatusType CountPlayersInLevelRange(void* DS, int GroupID, int lowLevel, int highLevel, int* numOfPlayers)
+{
+	if (DS == NULL)
+		return INVALID_INPUT;
+	if (isSharded(DS))
+		return FAILURE;
+	auto lock = asManager(DS)->lockShared();
+	return asManager(DS)->CountPlayersInLevelRange(GroupID, lowLevel, highLevel, numOfPlayers);
+}
+
+StatusType GetPlayerRank(void* DS, int PlayerID, int GroupID, int* Rank)
+{
+	if (DS == NULL)
+		return INVALID_INPUT;
+	if (isSharded(DS))
+		return FAILURE;
+	auto lock = asManager(DS)->lockShared();
+	return asManager(DS)->GetPlayerRank(PlayerID, GroupID, Rank);
 }
 
 StatusType GetGroupsHighestLevel(void* DS, int numOfGroups, int** Players)
 {
 	if (DS == NULL)
 		return INVALID_INPUT;
-	return ((PlayersManager*)DS)->GetGroupsHighestLevel(numOfGroups, Players);
+	if (isSharded(DS))
+		return asSharded(DS)->GetGroupsHighestLevel(numOfGroups, Players);
+	auto lock = asManager(DS)->lockShared();
+	return asManager(DS)->GetGroupsHighestLevel(numOfGroups, Players);
+}
+
+void* OpenLeaderboardView(void* DS)
+{
+	if (DS == NULL || isSharded(DS))
+		return NULL;
+	auto lock = asManager(DS)->lockExclusive();
+	return asManager(DS)->OpenLeaderboardView();
+}
+
+StatusType LeaderboardViewGetSize(void* View, int* numOfPlayers)
+{
+	if (View == NULL || numOfPlayers == NULL)
+		return INVALID_INPUT;
+	*numOfPlayers = ((LeaderboardView*)View)->getSize();
+	return SUCCESS;
+}
+
+StatusType LeaderboardViewGetTopPlayers(void* View, int k, int offset, int* Players, int* numOfPlayers)
+{
+	if (View == NULL || k < 0 || offset < 0 || (!Players && k > 0) || !numOfPlayers)
+		return INVALID_INPUT;
+	int j = 0;
+	*numOfPlayers = ((LeaderboardView*)View)->visitDescending(offset, k,
+		[Players, &j](uint64_t key) { Players[j++] = PlayerPointer::idOfKey(key); });
+	return SUCCESS;
+}
+
+void CloseLeaderboardView(void** View)
+{
+	if (View == NULL || *View == NULL)
+		return;
+	delete* ((LeaderboardView**)View);
+	*View = NULL;
+}
+
+StatusType SaveSnapshot(void* DS, const char* path)
+{
+	if (DS == NULL)
+		return INVALID_INPUT;
+	if (isSharded(DS))
+		return FAILURE;
+	auto lock = asManager(DS)->lockShared();
+	return asManager(DS)->SaveSnapshot(path);
+}
+
+StatusType LoadSnapshot(void* DS, const char* path)
+{
+	if (DS == NULL)
+		return INVALID_INPUT;
+	if (isSharded(DS))
+		return FAILURE;
+	auto lock = asManager(DS)->lockExclusive();
+	return asManager(DS)->LoadSnapshot(path);
+}
+
+StatusType OpenLog(void* DS, const char* path, int batchSize)
+{
+	if (DS == NULL)
+		return INVALID_INPUT;
+	if (isSharded(DS))
+		return FAILURE;
+	auto lock = asManager(DS)->lockExclusive();
+	return asManager(DS)->OpenLog(path, batchSize);
+}
+
+StatusType SyncLog(void* DS)
+{
+	if (DS == NULL)
+		return INVALID_INPUT;
+	if (isSharded(DS))
+		return FAILURE;
+	auto lock = asManager(DS)->lockExclusive();
+	return asManager(DS)->SyncLog();
+}
+
+StatusType Checkpoint(void* DS, const char* snapshotPath)
+{
+	if (DS == NULL)
+		return INVALID_INPUT;
+	if (isSharded(DS))
+		return FAILURE;
+	auto lock = asManager(DS)->lockExclusive();
+	return asManager(DS)->Checkpoint(snapshotPath);
+}
+
+StatusType Recover(void* DS, const char* snapshotPath, const char* logPath, int batchSize)
+{
+	if (DS == NULL)
+		return INVALID_INPUT;
+	if (isSharded(DS))
+		return FAILURE;
+	auto lock = asManager(DS)->lockExclusive();
+	return asManager(DS)->Recover(snapshotPath, logPath, batchSize);
+}
+
+StatusType SaveFrozenSnapshot(void* DS, const char* path)
+{
+	if (DS == NULL)
+		return INVALID_INPUT;
+	if (isSharded(DS))
+		return FAILURE;
+	auto lock = asManager(DS)->lockShared();
+	return asManager(DS)->SaveFrozenSnapshot(path);
+}
+
+void* OpenReplica(const char* path)
+{
+	FrozenSnapshot* replica = new FrozenSnapshot();
+	if (replica->Open(path) != SUCCESS) {
+		delete replica;
+		return NULL;
+	}
+	return replica;
+}
+
+StatusType ReplicaGetHighestLevel(void* R, int GroupID, int* PlayerID)
+{
+	if (R == NULL)
+		return INVALID_INPUT;
+	return ((FrozenSnapshot*)R)->GetHighestLevel(GroupID, PlayerID);
+}
+
+StatusType ReplicaGetAllPlayersByLevel(void* R, int GroupID, int** Players, int* numOfPlayers)
+{
+	if (R == NULL)
+		return INVALID_INPUT;
+	return ((FrozenSnapshot*)R)->GetAllPlayersByLevel(GroupID, Players, numOfPlayers);
+}
+
+StatusType ReplicaGetGroupsHighestLevel(void* R, int numOfGroups, int** Players)
+{
+	if (R == NULL)
+		return INVALID_INPUT;
+	return ((FrozenSnapshot*)R)->GetGroupsHighestLevel(numOfGroups, Players);
+}
+
+void CloseReplica(void** R)
+{
+	if (R == NULL || *R == NULL)
+		return;
+	delete* ((FrozenSnapshot**)R);
+	*R = NULL;
 }
 
 void Quit(void** DS)
 {
 	if (DS == NULL || *DS == NULL)
 		return;
-	delete* ((PlayersManager**)DS);
+	if (isSharded(*DS))
+		delete asSharded(*DS);
+	else
+		delete asManager(*DS);
 	*DS = NULL;
 }
@@ -27,25 +27,149 @@ typedef enum {
     INVALID_INPUT = -3
 } StatusType;
 
+/* Called once per player, return non-zero to stop the walk
+ * ----------------------------------- */
+typedef int (*PlayerVisitor)(int PlayerID, void *context);
+
+/* One player of a bulk import
+ * ----------------------------------- */
+typedef struct {
+    int PlayerID;
+    int GroupID;
+    int Level;
+} PlayerEntry;
+
+/* One call of ApplyBatch, with the arguments of the call in order; unused arguments are ignored
+ * ----------------------------------- */
+typedef enum {
+    BATCH_ADD_GROUP,
+    BATCH_ADD_PLAYER,
+    BATCH_REMOVE_PLAYER,
+    BATCH_REPLACE_GROUP,
+    BATCH_INCREASE_LEVEL
+} BatchOpType;
+
+typedef struct {
+    BatchOpType type;
+    int arg1;
+    int arg2;
+    int arg3;
+} BatchOp;
+
 
 void *Init();
 
+/* Like Init, but the DS may be called from several threads at once: the queries run in parallel
+ * with each other and every other call runs alone. GetHighestLevel takes no lock at all, it
+ * reads answers the other calls publish. A PlayerVisitor must not call into the DS. */
+void *InitConcurrent();
+
+/* Like InitConcurrent, with the groups split over numOfShards independent shards so calls about
+ * groups in different shards also run in parallel. Supports AddGroup, AddPlayer, RemovePlayer,
+ * ReplaceGroup, IncreaseLevel, ApplyBatch, GetHighestLevel, GetAllPlayersByLevel and
+ * GetGroupsHighestLevel; the other calls return FAILURE on it. NULL if numOfShards < 1. */
+void *InitSharded(int numOfShards);
+
 StatusType AddGroup(void *DS, int GroupID);
 
 StatusType AddPlayer(void *DS, int PlayerID, int GroupID, int Level);
 
+/* Adds all the players or none of them: INVALID_INPUT or FAILURE on any entry AddPlayer would
+ * reject, and also FAILURE if two entries share a PlayerID. */
+StatusType AddPlayersBulk(void *DS, const PlayerEntry *Players, int numOfPlayers);
+
 StatusType RemovePlayer(void *DS, int PlayerID);
 
 StatusType ReplaceGroup(void *DS, int GroupID, int ReplacementID);
 
 StatusType IncreaseLevel(void *DS, int PlayerID, int LevelIncrease);
 
+/* Applies the numOfOps calls in order as one call, and sets results[i] to what ops[i] returned,
+ * exactly as if they were made one by one. Cheaper than the separate calls: the lock is taken
+ * once, adjacent calls about the same group or player share its lookup, increases of one player
+ * in a row move it once, and a long run of AddPlayer goes in through AddPlayersBulk when all of
+ * them succeed. An unknown type gives INVALID_INPUT. */
+StatusType ApplyBatch(void *DS, const BatchOp *ops, int numOfOps, StatusType *results);
+
 StatusType GetHighestLevel(void *DS, int GroupID, int *PlayerID);
 
 StatusType GetAllPlayersByLevel(void *DS, int GroupID, int **Players, int *numOfPlayers);
 
+/* Writes the ids into the caller's buffer instead of a new array. numOfPlayers is set to the
+ * number of players either way; if it is larger than capacity only the first capacity ids are
+ * written and FAILURE is returned. */
+StatusType GetAllPlayersByLevelInto(void *DS, int GroupID, int *Players, int capacity, int *numOfPlayers);
+
+/* Calls visit with each player id in the order of GetAllPlayersByLevel, without copying. The DS
+ * must not be changed from inside visit. */
+StatusType ForEachPlayerByLevel(void *DS, int GroupID, PlayerVisitor visit, void *context);
+
+/* One page of GetAllPlayersByLevel: writes the players at positions offset..offset+k-1 of its
+ * order into Players, which must hold k ids, and sets numOfPlayers to how many were written
+ * (fewer than k on the last page, 0 past it). Costs O(log n + k), not O(n). */
+StatusType GetTopPlayersByLevel(void *DS, int GroupID, int k, int offset, int *Players, int *numOfPlayers);
+
+/* Number of players of the group (of all players if GroupID < 0) whose level is in
+ * [lowLevel, highLevel]. O(log n). */
+StatusType CountPlayersInLevelRange(void *DS, int GroupID, int lowLevel, int highLevel, int *numOfPlayers);
+
+/* 1-based position of the player in GetAllPlayersByLevel's order, among all players if GroupID < 0
+ * or within its group otherwise, in which case GroupID must be the player's group. O(log n). */
+StatusType GetPlayerRank(void *DS, int PlayerID, int GroupID, int *Rank);
+
 StatusType GetGroupsHighestLevel(void *DS, int numOfGroups, int **Players);
 
+/* Frozen view of every player by level, as GetAllPlayersByLevel(DS, -1) listed them when the
+ * view was opened. Later calls on the DS do not change the view and are not blocked by it, so a
+ * long export can page through it while the DS keeps changing. Opening costs O(1), except the
+ * first view of a DS which costs O(n); from then on every change of a level also copies O(log n)
+ * nodes the open views still share. A view may be read and closed on any thread.
+ * NULL on a sharded DS or out of memory. */
+void *OpenLeaderboardView(void *DS);
+
+StatusType LeaderboardViewGetSize(void *View, int *numOfPlayers);
+
+/* Like GetTopPlayersByLevel(DS, -1, ...) on the view. O(log n + k). */
+StatusType LeaderboardViewGetTopPlayers(void *View, int k, int offset, int *Players, int *numOfPlayers);
+
+void CloseLeaderboardView(void **View);
+
+/* Writes the groups and players to path in a compact binary format, in host byte order. */
+StatusType SaveSnapshot(void *DS, const char *path);
+
+/* Restores a snapshot into a manager with no groups yet, FAILURE if it has some or if the file
+ * cannot be read or is corrupt, in which case the manager is left empty. */
+StatusType LoadSnapshot(void *DS, const char *path);
+
+/* Write-ahead log of the successful mutations. Records are flushed to disk in batches of
+ * batchSize, or on SyncLog; a crash loses only the records of the last unflushed batch.
+ * OpenLog appends to the log at path, which must end at the current state, or creates it. */
+StatusType OpenLog(void *DS, const char *path, int batchSize);
+
+StatusType SyncLog(void *DS);
+
+/* Replaces the snapshot at snapshotPath with the current state and starts the log over. */
+StatusType Checkpoint(void *DS, const char *snapshotPath);
+
+/* Restores a new DS from the snapshot (NULL for none) and the log after it, then keeps logging
+ * to logPath. */
+StatusType Recover(void *DS, const char *snapshotPath, const char *logPath, int batchSize);
+
+/* Writes a frozen snapshot, the file a read-only replica maps to answer queries. */
+StatusType SaveFrozenSnapshot(void *DS, const char *path);
+
+/* Read-only replica over a frozen snapshot. OpenReplica returns NULL if the file cannot be
+ * mapped or is not a frozen snapshot; the queries behave like their DS counterparts. */
+void *OpenReplica(const char *path);
+
+StatusType ReplicaGetHighestLevel(void *R, int GroupID, int *PlayerID);
+
+StatusType ReplicaGetAllPlayersByLevel(void *R, int GroupID, int **Players, int *numOfPlayers);
+
+StatusType ReplicaGetGroupsHighestLevel(void *R, int numOfGroups, int **Players);
+
+void CloseReplica(void **R);
+
 void Quit(void** DS);
 
 #ifdef __cplusplus
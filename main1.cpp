@@ -38,10 +38,38 @@ typedef enum {
 	GETHIGHESTLEVEL_CMD = 6,
 	GETALLPLAYERS_CMD = 7,
 	GETGROUPSHIGHEST_CMD = 8,
-	QUIT_CMD = 9
+	QUIT_CMD = 9,
+	ADDPLAYERSBULK_CMD = 10,
+	SAVESNAPSHOT_CMD = 11,
+	LOADSNAPSHOT_CMD = 12,
+	DELETEFILE_CMD = 13,
+	TRUNCATEFILE_CMD = 14,
+	PATCHFILE_CMD = 15,
+	SAVEFROZEN_CMD = 16,
+	OPENREPLICA_CMD = 17,
+	REPLICAGETHIGHEST_CMD = 18,
+	REPLICAGETALLPLAYERS_CMD = 19,
+	REPLICAGETGROUPSHIGHEST_CMD = 20,
+	CLOSEREPLICA_CMD = 21,
+	OPENLOG_CMD = 22,
+	SYNCLOG_CMD = 23,
+	CHECKPOINT_CMD = 24,
+	RECOVER_CMD = 25,
+	GETALLPLAYERSINTO_CMD = 26,
+	FOREACHPLAYER_CMD = 27,
+	GETTOPPLAYERS_CMD = 28,
+	COUNTINRANGE_CMD = 29,
+	GETPLAYERRANK_CMD = 30,
+	INITCONCURRENT_CMD = 31,
+	INITSHARDED_CMD = 32,
+	OPENVIEW_CMD = 33,
+	VIEWGETSIZE_CMD = 34,
+	VIEWGETTOP_CMD = 35,
+	CLOSEVIEW_CMD = 36,
+	APPLYBATCH_CMD = 37
 } commandType;
 
-static const int numActions = 10;
+static const int numActions = 38;
 static const char *commandStr[] = {
 		"Init",
 		"AddGroup",
@@ -52,7 +80,35 @@ static const char *commandStr[] = {
 		"GetHighestLevel",
 		"GetAllPlayersByLevel",
 		"GetGroupsHighestLevel",
-		"Quit" };
+		"Quit",
+		"AddPlayersBulk",
+		"SaveSnapshot",
+		"LoadSnapshot",
+		"DeleteFile",
+		"TruncateFile",
+		"PatchFile",
+		"SaveFrozenSnapshot",
+		"OpenReplica",
+		"ReplicaGetHighestLevel",
+		"ReplicaGetAllPlayersByLevel",
+		"ReplicaGetGroupsHighestLevel",
+		"CloseReplica",
+		"OpenLog",
+		"SyncLog",
+		"Checkpoint",
+		"Recover",
+		"GetAllPlayersByLevelInto",
+		"ForEachPlayerByLevel",
+		"GetTopPlayersByLevel",
+		"CountPlayersInLevelRange",
+		"GetPlayerRank",
+		"InitConcurrent",
+		"InitSharded",
+		"OpenLeaderboardView",
+		"LeaderboardViewGetSize",
+		"LeaderboardViewGetTopPlayers",
+		"CloseLeaderboardView",
+		"ApplyBatch" };
 
 static const char* ReturnValToStr(int val) {
 	switch (val) {
@@ -115,7 +171,10 @@ static commandType CheckCommand(const char* const command,
 		return (COMMENT_CMD);
 	};
 	for (int index = 0; index < numActions; index++) {
-		if (StrCmp(commandStr[index], command)) {
+		/* the whole word must match, AddPlayer is a prefix of AddPlayersBulk */
+		char next = command[strlen(commandStr[index])];
+		if (StrCmp(commandStr[index], command)
+				&& (next == ' ' || next == '\n' || next == '\r' || next == '\0')) {
 			*command_arg = command + strlen(commandStr[index]) + 1;
 			return ((commandType) index);
 		};
@@ -137,6 +196,34 @@ static errorType OnGetHighestLevel(void* DS, const char* const command);
 static errorType OnGetAllPlayersByLevel(void* DS, const char* const command);
 static errorType OnGetGroupsHighestLevel(void* DS, const char* const command);
 static errorType OnQuit(void** DS, const char* const command);
+static errorType OnAddPlayersBulk(void* DS, const char* const command);
+static errorType OnSaveSnapshot(void* DS, const char* const command);
+static errorType OnLoadSnapshot(void* DS, const char* const command);
+static errorType OnDeleteFile(const char* const command);
+static errorType OnTruncateFile(const char* const command);
+static errorType OnPatchFile(const char* const command);
+static errorType OnSaveFrozenSnapshot(void* DS, const char* const command);
+static errorType OnOpenReplica(void** Replica, const char* const command);
+static errorType OnReplicaGetHighestLevel(void* Replica, const char* const command);
+static errorType OnReplicaGetAllPlayersByLevel(void* Replica, const char* const command);
+static errorType OnReplicaGetGroupsHighestLevel(void* Replica, const char* const command);
+static errorType OnCloseReplica(void** Replica);
+static errorType OnOpenLog(void* DS, const char* const command);
+static errorType OnSyncLog(void* DS);
+static errorType OnCheckpoint(void* DS, const char* const command);
+static errorType OnRecover(void* DS, const char* const command);
+static errorType OnGetAllPlayersByLevelInto(void* DS, const char* const command);
+static errorType OnForEachPlayerByLevel(void* DS, const char* const command);
+static errorType OnGetTopPlayersByLevel(void* DS, const char* const command);
+static errorType OnCountPlayersInLevelRange(void* DS, const char* const command);
+static errorType OnGetPlayerRank(void* DS, const char* const command);
+static errorType OnInitConcurrent(void** DS);
+static errorType OnInitSharded(void** DS, const char* const command);
+static errorType OnOpenLeaderboardView(void* DS, void** View);
+static errorType OnLeaderboardViewGetSize(void* View);
+static errorType OnLeaderboardViewGetTopPlayers(void* View, const char* const command);
+static errorType OnCloseLeaderboardView(void** View);
+static errorType OnApplyBatch(void* DS, const char* const command);
 
 /***************************************************************************/
 /* Parser                                                                  */
@@ -144,6 +231,8 @@ static errorType OnQuit(void** DS, const char* const command);
 
 static errorType parser(const char* const command) {
 	static void *DS = NULL; /* The general data structure */
+	static void *Replica = NULL; /* The open read-only replica, if any */
+	static void *View = NULL; /* The open leaderboard view of DS, if any */
 	const char* command_args = NULL;
 	errorType rtn_val = error;
 
@@ -181,6 +270,90 @@ static errorType parser(const char* const command) {
 	case (QUIT_CMD):
 		rtn_val = OnQuit(&DS, command_args);
 		break;
+	case (ADDPLAYERSBULK_CMD):
+		rtn_val = OnAddPlayersBulk(DS, command_args);
+		break;
+	case (SAVESNAPSHOT_CMD):
+		rtn_val = OnSaveSnapshot(DS, command_args);
+		break;
+	case (LOADSNAPSHOT_CMD):
+		rtn_val = OnLoadSnapshot(DS, command_args);
+		break;
+	case (DELETEFILE_CMD):
+		rtn_val = OnDeleteFile(command_args);
+		break;
+	case (TRUNCATEFILE_CMD):
+		rtn_val = OnTruncateFile(command_args);
+		break;
+	case (PATCHFILE_CMD):
+		rtn_val = OnPatchFile(command_args);
+		break;
+	case (SAVEFROZEN_CMD):
+		rtn_val = OnSaveFrozenSnapshot(DS, command_args);
+		break;
+	case (OPENREPLICA_CMD):
+		rtn_val = OnOpenReplica(&Replica, command_args);
+		break;
+	case (REPLICAGETHIGHEST_CMD):
+		rtn_val = OnReplicaGetHighestLevel(Replica, command_args);
+		break;
+	case (REPLICAGETALLPLAYERS_CMD):
+		rtn_val = OnReplicaGetAllPlayersByLevel(Replica, command_args);
+		break;
+	case (REPLICAGETGROUPSHIGHEST_CMD):
+		rtn_val = OnReplicaGetGroupsHighestLevel(Replica, command_args);
+		break;
+	case (CLOSEREPLICA_CMD):
+		rtn_val = OnCloseReplica(&Replica);
+		break;
+	case (OPENLOG_CMD):
+		rtn_val = OnOpenLog(DS, command_args);
+		break;
+	case (SYNCLOG_CMD):
+		rtn_val = OnSyncLog(DS);
+		break;
+	case (CHECKPOINT_CMD):
+		rtn_val = OnCheckpoint(DS, command_args);
+		break;
+	case (RECOVER_CMD):
+		rtn_val = OnRecover(DS, command_args);
+		break;
+	case (GETALLPLAYERSINTO_CMD):
+		rtn_val = OnGetAllPlayersByLevelInto(DS, command_args);
+		break;
+	case (FOREACHPLAYER_CMD):
+		rtn_val = OnForEachPlayerByLevel(DS, command_args);
+		break;
+	case (GETTOPPLAYERS_CMD):
+		rtn_val = OnGetTopPlayersByLevel(DS, command_args);
+		break;
+	case (COUNTINRANGE_CMD):
+		rtn_val = OnCountPlayersInLevelRange(DS, command_args);
+		break;
+	case (GETPLAYERRANK_CMD):
+		rtn_val = OnGetPlayerRank(DS, command_args);
+		break;
+	case (INITCONCURRENT_CMD):
+		rtn_val = OnInitConcurrent(&DS);
+		break;
+	case (INITSHARDED_CMD):
+		rtn_val = OnInitSharded(&DS, command_args);
+		break;
+	case (OPENVIEW_CMD):
+		rtn_val = OnOpenLeaderboardView(DS, &View);
+		break;
+	case (VIEWGETSIZE_CMD):
+		rtn_val = OnLeaderboardViewGetSize(View);
+		break;
+	case (VIEWGETTOP_CMD):
+		rtn_val = OnLeaderboardViewGetTopPlayers(View, command_args);
+		break;
+	case (CLOSEVIEW_CMD):
+		rtn_val = OnCloseLeaderboardView(&View);
+		break;
+	case (APPLYBATCH_CMD):
+		rtn_val = OnApplyBatch(DS, command_args);
+		break;
 
 	case (COMMENT_CMD):
 		rtn_val = error_free;
@@ -215,6 +388,48 @@ static errorType OnInit(void** DS, const char* const command) {
 	return error_free;
 }
 
+/***************************************************************************/
+/* OnInitConcurrent                                                        */
+/***************************************************************************/
+static errorType OnInitConcurrent(void** DS) {
+	if (isInit) {
+		printf("Init was already called.\n");
+		return (error_free);
+	};
+	isInit = true;
+
+	*DS = InitConcurrent();
+	if (*DS == NULL) {
+		printf("InitConcurrent failed.\n");
+		return error;
+	};
+	printf("InitConcurrent done.\n");
+
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnInitSharded                                                           */
+/***************************************************************************/
+static errorType OnInitSharded(void** DS, const char* const command) {
+	int numOfShards;
+	ValidateRead(sscanf_s(command, "%d", &numOfShards), 1, "InitSharded failed.\n");
+	if (isInit) {
+		printf("Init was already called.\n");
+		return (error_free);
+	};
+	isInit = true;
+
+	*DS = InitSharded(numOfShards);
+	if (*DS == NULL) {
+		printf("InitSharded failed.\n");
+		return error;
+	};
+	printf("InitSharded done.\n");
+
+	return error_free;
+}
+
 /***************************************************************************/
 /* OnAddGroup                                                             */
 /***************************************************************************/
@@ -411,6 +626,552 @@ static errorType OnQuit(void** DS, const char* const command) {
 	return error_free;
 }
 
+/***************************************************************************/
+/* ReadPath: copies the next word of command into path, sscanf_s differs  */
+/* between the compilers on strings. Returns what follows, NULL if none   */
+/***************************************************************************/
+static const char* ReadPath(const char* command, char* path) {
+	while (*command == ' ' || *command == '\t')
+		command++;
+	int length = 0;
+	while (command[length] != '\0' && command[length] != ' ' && command[length] != '\t'
+			&& command[length] != '\n' && command[length] != '\r' && length < MAX_STRING_INPUT_SIZE - 1) {
+		path[length] = command[length];
+		length++;
+	}
+	path[length] = '\0';
+	return length == 0 ? NULL : command + length;
+}
+
+/***************************************************************************/
+/* OnAddPlayersBulk                                                        */
+/* AddPlayersBulk <count> then count times <playerID> <groupID> <level>    */
+/***************************************************************************/
+#define MAX_BULK_PLAYERS (32)
+
+static errorType OnAddPlayersBulk(void* DS, const char* const command) {
+	int numOfPlayers;
+	int read;
+	ValidateRead(sscanf_s(command, "%d%n", &numOfPlayers, &read), 1, "AddPlayersBulk failed.\n");
+	ValidateRead(numOfPlayers >= 0 && numOfPlayers <= MAX_BULK_PLAYERS, true, "AddPlayersBulk failed.\n");
+
+	PlayerEntry players[MAX_BULK_PLAYERS];
+	const char* next = command + read;
+	for (int i = 0; i < numOfPlayers; i++) {
+		ValidateRead(sscanf_s(next, "%d %d %d%n", &players[i].PlayerID, &players[i].GroupID,
+				&players[i].Level, &read), 3, "AddPlayersBulk failed.\n");
+		next += read;
+	}
+	StatusType res = AddPlayersBulk(DS, players, numOfPlayers);
+
+	printf("AddPlayersBulk: %s\n", ReturnValToStr(res));
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnSaveSnapshot                                                          */
+/***************************************************************************/
+static errorType OnSaveSnapshot(void* DS, const char* const command) {
+	char path[MAX_STRING_INPUT_SIZE];
+	ValidateRead(ReadPath(command, path) == NULL ? 0 : 1, 1, "SaveSnapshot failed.\n");
+	StatusType res = SaveSnapshot(DS, path);
+
+	printf("SaveSnapshot: %s\n", ReturnValToStr(res));
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnLoadSnapshot                                                          */
+/***************************************************************************/
+static errorType OnLoadSnapshot(void* DS, const char* const command) {
+	char path[MAX_STRING_INPUT_SIZE];
+	ValidateRead(ReadPath(command, path) == NULL ? 0 : 1, 1, "LoadSnapshot failed.\n");
+	StatusType res = LoadSnapshot(DS, path);
+
+	printf("LoadSnapshot: %s\n", ReturnValToStr(res));
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnSaveFrozenSnapshot                                                    */
+/***************************************************************************/
+static errorType OnSaveFrozenSnapshot(void* DS, const char* const command) {
+	char path[MAX_STRING_INPUT_SIZE];
+	ValidateRead(ReadPath(command, path) == NULL ? 0 : 1, 1, "SaveFrozenSnapshot failed.\n");
+	StatusType res = SaveFrozenSnapshot(DS, path);
+
+	printf("SaveFrozenSnapshot: %s\n", ReturnValToStr(res));
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnOpenReplica                                                           */
+/* One replica is open at a time, opening another closes the previous one  */
+/***************************************************************************/
+static errorType OnOpenReplica(void** Replica, const char* const command) {
+	char path[MAX_STRING_INPUT_SIZE];
+	ValidateRead(ReadPath(command, path) == NULL ? 0 : 1, 1, "OpenReplica failed.\n");
+	CloseReplica(Replica);
+	*Replica = OpenReplica(path);
+
+	printf("OpenReplica: %s\n", *Replica != NULL ? "SUCCESS" : "FAILURE");
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnReplicaGetHighestLevel                                                */
+/***************************************************************************/
+static errorType OnReplicaGetHighestLevel(void* Replica, const char* const command) {
+	int groupID;
+	ValidateRead(sscanf_s(command, "%d", &groupID), 1, "ReplicaGetHighestLevel failed.\n");
+	int playerID;
+	StatusType res = ReplicaGetHighestLevel(Replica, groupID, &playerID);
+
+	if (res != SUCCESS) {
+		printf("ReplicaGetHighestLevel: %s\n", ReturnValToStr(res));
+		return error_free;
+	}
+
+	cout << "Highest level player is: " << playerID << endl;
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnReplicaGetAllPlayersByLevel                                           */
+/***************************************************************************/
+static errorType OnReplicaGetAllPlayersByLevel(void* Replica, const char* const command) {
+	int groupID;
+	ValidateRead(sscanf_s(command, "%d", &groupID), 1, "ReplicaGetAllPlayersByLevel failed.\n");
+	int* playerIDs;
+	int numOfPlayers;
+	StatusType res = ReplicaGetAllPlayersByLevel(Replica, groupID, &playerIDs, &numOfPlayers);
+
+	if (res != SUCCESS) {
+		printf("ReplicaGetAllPlayersByLevel: %s\n", ReturnValToStr(res));
+		return error_free;
+	}
+
+	PrintAll(playerIDs, numOfPlayers);
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnReplicaGetGroupsHighestLevel                                          */
+/***************************************************************************/
+static errorType OnReplicaGetGroupsHighestLevel(void* Replica, const char* const command) {
+	int numOfGroups;
+	ValidateRead(sscanf_s(command, "%d", &numOfGroups), 1, "ReplicaGetGroupsHighestLevel failed.\n");
+	int* playerIDs;
+	StatusType res = ReplicaGetGroupsHighestLevel(Replica, numOfGroups, &playerIDs);
+
+	if (res != SUCCESS) {
+		printf("ReplicaGetGroupsHighestLevel: %s\n", ReturnValToStr(res));
+		return error_free;
+	}
+
+	PrintGroupsHighest(playerIDs, numOfGroups);
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnCloseReplica                                                          */
+/***************************************************************************/
+static errorType OnCloseReplica(void** Replica) {
+	CloseReplica(Replica);
+
+	printf("CloseReplica done.\n");
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnOpenLog                                                               */
+/***************************************************************************/
+static errorType OnOpenLog(void* DS, const char* const command) {
+	char path[MAX_STRING_INPUT_SIZE];
+	const char* rest = ReadPath(command, path);
+	int batchSize;
+	ValidateRead(rest == NULL ? 0 : sscanf_s(rest, "%d", &batchSize), 1, "OpenLog failed.\n");
+	StatusType res = OpenLog(DS, path, batchSize);
+
+	printf("OpenLog: %s\n", ReturnValToStr(res));
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnSyncLog                                                               */
+/***************************************************************************/
+static errorType OnSyncLog(void* DS) {
+	StatusType res = SyncLog(DS);
+
+	printf("SyncLog: %s\n", ReturnValToStr(res));
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnCheckpoint                                                            */
+/***************************************************************************/
+static errorType OnCheckpoint(void* DS, const char* const command) {
+	char path[MAX_STRING_INPUT_SIZE];
+	ValidateRead(ReadPath(command, path) == NULL ? 0 : 1, 1, "Checkpoint failed.\n");
+	StatusType res = Checkpoint(DS, path);
+
+	printf("Checkpoint: %s\n", ReturnValToStr(res));
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnRecover                                                               */
+/* Recover <snapshot path, or - for none> <log path> <batch size>          */
+/***************************************************************************/
+static errorType OnRecover(void* DS, const char* const command) {
+	char snapshotPath[MAX_STRING_INPUT_SIZE];
+	char logPath[MAX_STRING_INPUT_SIZE];
+	const char* rest = ReadPath(command, snapshotPath);
+	if (rest != NULL)
+		rest = ReadPath(rest, logPath);
+	int batchSize;
+	ValidateRead(rest == NULL ? 0 : sscanf_s(rest, "%d", &batchSize), 1, "Recover failed.\n");
+	StatusType res = Recover(DS, strcmp(snapshotPath, "-") == 0 ? NULL : snapshotPath, logPath, batchSize);
+
+	printf("Recover: %s\n", ReturnValToStr(res));
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnGetAllPlayersByLevelInto                                              */
+/* GetAllPlayersByLevelInto <groupID> <capacity>, prints the ids written   */
+/* and the full count when one is reported                                 */
+/***************************************************************************/
+#define MAX_INTO_PLAYERS (64)
+
+static errorType OnGetAllPlayersByLevelInto(void* DS, const char* const command) {
+	int groupID;
+	int capacity;
+	ValidateRead(sscanf_s(command, "%d %d", &groupID, &capacity), 2, "GetAllPlayersByLevelInto failed.\n");
+	ValidateRead(capacity <= MAX_INTO_PLAYERS, true, "GetAllPlayersByLevelInto failed.\n");
+	int playerIDs[MAX_INTO_PLAYERS];
+	int numOfPlayers = -1;
+	StatusType res = GetAllPlayersByLevelInto(DS, groupID, playerIDs, capacity, &numOfPlayers);
+
+	printf("GetAllPlayersByLevelInto: %s\n", ReturnValToStr(res));
+	if (numOfPlayers < 0) {
+		return error_free;
+	}
+
+	int written = numOfPlayers < capacity ? numOfPlayers : capacity;
+	if (written > 0) {
+		cout << "Rank	||	Player" << endl;
+	}
+	for (int i = 0; i < written; i++) {
+		cout << i + 1 << "\t||\t" << playerIDs[i] << endl;
+	}
+	cout << numOfPlayers << " players in all" << endl;
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnForEachPlayerByLevel                                                  */
+/* ForEachPlayerByLevel <groupID> <stop after, 0 to visit all>             */
+/***************************************************************************/
+typedef struct {
+	int visited;
+	int stopAfter;
+} VisitCount;
+
+static int PrintVisited(int PlayerID, void* context) {
+	VisitCount* count = (VisitCount*)context;
+	if (count->visited == 0) {
+		cout << "Rank	||	Player" << endl;
+	}
+	cout << ++count->visited << "\t||\t" << PlayerID << endl;
+	return count->visited == count->stopAfter;
+}
+
+static errorType OnForEachPlayerByLevel(void* DS, const char* const command) {
+	int groupID;
+	VisitCount count = { 0, 0 };
+	ValidateRead(sscanf_s(command, "%d %d", &groupID, &count.stopAfter), 2, "ForEachPlayerByLevel failed.\n");
+	StatusType res = ForEachPlayerByLevel(DS, groupID, PrintVisited, &count);
+
+	printf("ForEachPlayerByLevel: %s, %d visited\n", ReturnValToStr(res), count.visited);
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnGetTopPlayersByLevel                                                  */
+/* GetTopPlayersByLevel <groupID> <k> <offset>                             */
+/***************************************************************************/
+#define MAX_PAGE_PLAYERS (64)
+
+static errorType OnGetTopPlayersByLevel(void* DS, const char* const command) {
+	int groupID;
+	int k;
+	int offset;
+	ValidateRead(sscanf_s(command, "%d %d %d", &groupID, &k, &offset), 3, "GetTopPlayersByLevel failed.\n");
+	ValidateRead(k <= MAX_PAGE_PLAYERS, true, "GetTopPlayersByLevel failed.\n");
+	int playerIDs[MAX_PAGE_PLAYERS];
+	int numOfPlayers;
+	StatusType res = GetTopPlayersByLevel(DS, groupID, k, offset, playerIDs, &numOfPlayers);
+
+	if (res != SUCCESS) {
+		printf("GetTopPlayersByLevel: %s\n", ReturnValToStr(res));
+		return error_free;
+	}
+
+	if (numOfPlayers > 0) {
+		cout << "Rank	||	Player" << endl;
+	}
+	for (int i = 0; i < numOfPlayers; i++) {
+		cout << offset + i + 1 << "\t||\t" << playerIDs[i] << endl;
+	}
+	cout << "and there are no more players!" << endl;
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnCountPlayersInLevelRange                                              */
+/* CountPlayersInLevelRange <groupID> <lowLevel> <highLevel>               */
+/***************************************************************************/
+static errorType OnCountPlayersInLevelRange(void* DS, const char* const command) {
+	int groupID;
+	int lowLevel;
+	int highLevel;
+	ValidateRead(sscanf_s(command, "%d %d %d", &groupID, &lowLevel, &highLevel), 3,
+			"CountPlayersInLevelRange failed.\n");
+	int numOfPlayers;
+	StatusType res = CountPlayersInLevelRange(DS, groupID, lowLevel, highLevel, &numOfPlayers);
+
+	if (res != SUCCESS) {
+		printf("CountPlayersInLevelRange: %s\n", ReturnValToStr(res));
+		return error_free;
+	}
+
+	printf("Players in the range: %d\n", numOfPlayers);
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnGetPlayerRank                                                         */
+/* GetPlayerRank <playerID> <groupID>                                      */
+/***************************************************************************/
+static errorType OnGetPlayerRank(void* DS, const char* const command) {
+	int playerID;
+	int groupID;
+	ValidateRead(sscanf_s(command, "%d %d", &playerID, &groupID), 2, "GetPlayerRank failed.\n");
+	int rank;
+	StatusType res = GetPlayerRank(DS, playerID, groupID, &rank);
+
+	if (res != SUCCESS) {
+		printf("GetPlayerRank: %s\n", ReturnValToStr(res));
+		return error_free;
+	}
+
+	printf("Rank of player %d: %d\n", playerID, rank);
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnOpenLeaderboardView                                                   */
+/* One view is open at a time, opening another closes the previous one    */
+/***************************************************************************/
+static errorType OnOpenLeaderboardView(void* DS, void** View) {
+	CloseLeaderboardView(View);
+	*View = OpenLeaderboardView(DS);
+
+	printf("OpenLeaderboardView: %s\n", *View != NULL ? "SUCCESS" : "FAILURE");
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnLeaderboardViewGetSize                                                */
+/***************************************************************************/
+static errorType OnLeaderboardViewGetSize(void* View) {
+	int numOfPlayers;
+	StatusType res = LeaderboardViewGetSize(View, &numOfPlayers);
+
+	if (res != SUCCESS) {
+		printf("LeaderboardViewGetSize: %s\n", ReturnValToStr(res));
+		return error_free;
+	}
+
+	printf("Players in the view: %d\n", numOfPlayers);
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnLeaderboardViewGetTopPlayers                                          */
+/* LeaderboardViewGetTopPlayers <k> <offset>                               */
+/***************************************************************************/
+static errorType OnLeaderboardViewGetTopPlayers(void* View, const char* const command) {
+	int k;
+	int offset;
+	ValidateRead(sscanf_s(command, "%d %d", &k, &offset), 2, "LeaderboardViewGetTopPlayers failed.\n");
+	ValidateRead(k <= MAX_PAGE_PLAYERS, true, "LeaderboardViewGetTopPlayers failed.\n");
+	int playerIDs[MAX_PAGE_PLAYERS];
+	int numOfPlayers;
+	StatusType res = LeaderboardViewGetTopPlayers(View, k, offset, playerIDs, &numOfPlayers);
+
+	if (res != SUCCESS) {
+		printf("LeaderboardViewGetTopPlayers: %s\n", ReturnValToStr(res));
+		return error_free;
+	}
+
+	if (numOfPlayers > 0) {
+		cout << "Rank	||	Player" << endl;
+	}
+	for (int i = 0; i < numOfPlayers; i++) {
+		cout << offset + i + 1 << "\t||\t" << playerIDs[i] << endl;
+	}
+	cout << "and there are no more players!" << endl;
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnCloseLeaderboardView                                                  */
+/***************************************************************************/
+static errorType OnCloseLeaderboardView(void** View) {
+	CloseLeaderboardView(View);
+
+	printf("CloseLeaderboardView done.\n");
+	return error_free;
+}
+
+/***************************************************************************/
+/* OnApplyBatch                                                            */
+/* ApplyBatch then any of: AddGroup <groupID>,                             */
+/* AddPlayer <playerID> <groupID> <level>, RemovePlayer <playerID>,        */
+/* ReplaceGroup <groupID> <replacementID>, IncreaseLevel <playerID> <inc>, */
+/* and AddPlayers <first playerID> <count> <groupID> <level>, which stands */
+/* for count AddPlayer ops with the ids from the first one up.             */
+/* Prints the result of every op, equal results in a row as one range.     */
+/***************************************************************************/
+#define MAX_BATCH_OPS (16384)
+
+static errorType OnApplyBatch(void* DS, const char* const command) {
+	static BatchOp ops[MAX_BATCH_OPS];
+	static StatusType results[MAX_BATCH_OPS];
+	int numOfOps = 0;
+	char name[MAX_STRING_INPUT_SIZE];
+	const char* next = command;
+	int read;
+
+	while ((next = ReadPath(next, name)) != NULL) {
+		BatchOp op = { BATCH_ADD_GROUP, 0, 0, 0 };
+		int count = 1;
+		int numOfArgs;
+		if (strcmp(name, "AddGroup") == 0)
+			numOfArgs = sscanf_s(next, "%d%n", &op.arg1, &read) == 1 ? 1 : -1;
+		else if (strcmp(name, "AddPlayer") == 0 || strcmp(name, "AddPlayers") == 0) {
+			op.type = BATCH_ADD_PLAYER;
+			if (strcmp(name, "AddPlayer") == 0)
+				numOfArgs = sscanf_s(next, "%d %d %d%n", &op.arg1, &op.arg2, &op.arg3, &read) == 3 ? 3 : -1;
+			else
+				numOfArgs = sscanf_s(next, "%d %d %d %d%n", &op.arg1, &count, &op.arg2, &op.arg3, &read) == 4 ? 4 : -1;
+		}
+		else if (strcmp(name, "RemovePlayer") == 0) {
+			op.type = BATCH_REMOVE_PLAYER;
+			numOfArgs = sscanf_s(next, "%d%n", &op.arg1, &read) == 1 ? 1 : -1;
+		}
+		else if (strcmp(name, "ReplaceGroup") == 0) {
+			op.type = BATCH_REPLACE_GROUP;
+			numOfArgs = sscanf_s(next, "%d %d%n", &op.arg1, &op.arg2, &read) == 2 ? 2 : -1;
+		}
+		else if (strcmp(name, "IncreaseLevel") == 0) {
+			op.type = BATCH_INCREASE_LEVEL;
+			numOfArgs = sscanf_s(next, "%d %d%n", &op.arg1, &op.arg2, &read) == 2 ? 2 : -1;
+		}
+		else
+			numOfArgs = -1;
+		ValidateRead(numOfArgs > 0 && count >= 0 && numOfOps + count <= MAX_BATCH_OPS, true,
+			"ApplyBatch failed.\n");
+
+		for (int i = 0; i < count; i++) {
+			ops[numOfOps] = op;
+			ops[numOfOps++].arg1 = op.arg1 + i;
+		}
+		next += read;
+	}
+	StatusType res = ApplyBatch(DS, ops, numOfOps, results);
+
+	printf("ApplyBatch: %s\n", ReturnValToStr(res));
+	for (int first = 0, last; res == SUCCESS && first < numOfOps; first = last + 1) {
+		for (last = first; last + 1 < numOfOps && results[last + 1] == results[first]; last++);
+		if (first == last)
+			printf("op %d: %s\n", first + 1, ReturnValToStr(results[first]));
+		else
+			printf("ops %d-%d: %s\n", first + 1, last + 1, ReturnValToStr(results[first]));
+	}
+	return error_free;
+}
+
+/***************************************************************************/
+/* File commands, for the tests to start clean and to damage files the way */
+/* a crash or a bad disk would                                             */
+/***************************************************************************/
+static errorType OnDeleteFile(const char* const command) {
+	char path[MAX_STRING_INPUT_SIZE];
+	ValidateRead(ReadPath(command, path) == NULL ? 0 : 1, 1, "DeleteFile failed.\n");
+	remove(path);
+
+	printf("DeleteFile done.\n");
+	return error_free;
+}
+
+/* TruncateFile <path> <number of bytes to cut off the end> */
+static errorType OnTruncateFile(const char* const command) {
+	char path[MAX_STRING_INPUT_SIZE];
+	const char* rest = ReadPath(command, path);
+	long cut;
+	ValidateRead(rest == NULL ? 0 : sscanf_s(rest, "%ld", &cut), 1, "TruncateFile failed.\n");
+
+	FILE* file = fopen(path, "rb");
+	char* content = NULL;
+	long size = -1;
+	if (file != NULL && fseek(file, 0, SEEK_END) == 0)
+		size = ftell(file);
+	if (size >= cut && cut >= 0) {
+		content = (char*)malloc(size - cut + 1);
+		rewind(file);
+		if (content == NULL || fread(content, 1, size - cut, file) != (size_t)(size - cut))
+			size = -1;
+	}
+	if (file != NULL)
+		fclose(file);
+
+	if (size < cut || cut < 0 || (file = fopen(path, "wb")) == NULL) {
+		free(content);
+		printf("TruncateFile failed.\n");
+		return error_free;
+	}
+	fwrite(content, 1, size - cut, file);
+	fclose(file);
+	free(content);
+
+	printf("TruncateFile done.\n");
+	return error_free;
+}
+
+/* PatchFile <path> <byte offset> <value>, overwrites 4 bytes with the int value */
+static errorType OnPatchFile(const char* const command) {
+	char path[MAX_STRING_INPUT_SIZE];
+	const char* rest = ReadPath(command, path);
+	long offset;
+	int value;
+	ValidateRead(rest == NULL ? 0 : sscanf_s(rest, "%ld %d", &offset, &value), 2, "PatchFile failed.\n");
+
+	FILE* file = fopen(path, "r+b");
+	if (file == NULL || fseek(file, offset, SEEK_SET) != 0 || fwrite(&value, sizeof(value), 1, file) != 1) {
+		if (file != NULL)
+			fclose(file);
+		printf("PatchFile failed.\n");
+		return error_free;
+	}
+	fclose(file);
+
+	printf("PatchFile done.\n");
+	return error_free;
+}
+
 #ifdef __cplusplus
 }
 #endif